@@ -0,0 +1,42 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <avr/io.h>
+#include "hal.h"
+
+uint8_t hal_io[HAL_IO_SIZE];
+
+static void (*pollHook)(void) = NULL;
+
+/*
+ * @see hal.h
+ */
+void hal_reset(void) {
+	memset(hal_io, 0, sizeof(hal_io));
+	pollHook = NULL;
+}
+
+/*
+ * @see hal.h
+ */
+void hal_interrupt(void (*vector)(void)) {
+	SREG &= ~_BV(SREG_I);
+	vector();
+	SREG |= _BV(SREG_I);
+}
+
+/*
+ * @see hal.h
+ */
+void hal_setPollHook(void (*hook)(void)) {
+	pollHook = hook;
+}
+
+/*
+ * @see hal.h
+ */
+void hal_poll(void) {
+	if (pollHook != NULL) {
+		pollHook();
+	}
+}
@@ -0,0 +1,58 @@
+/**
+ * Simulated register file of the ATmega328P for the host build.
+ * 
+ * The drivers include the avr-libc headers and access the registers by
+ * name. On the target these are the SFR of the chip and nothing of this
+ * directory is compiled. On the host, the headers of host/include 
+ * replace avr-libc: the same names map to hal_io, a byte array laid out
+ * like the data space of the chip, so TWCR is hal_io[0xBC].
+ * 
+ * The registers are plain memory, a write has no side effect. The tests
+ * play the peripheral:
+ * 		- An interrupt is triggered with hal_interrupt(USART_RX_vect).
+ * 		- The poll hook is called by every loop_until_bit_is_set/clear()
+ * 		  and by sleep_cpu(). A model of the peripheral installed there 
+ * 		  answers the busy-waits of the drivers and can raise interrupts.
+ * 
+ * Usage:
+ * 		UDR0 = 'a';
+ * 		hal_interrupt(USART_RX_vect);
+ * 		assert(uart_read() == 'a');
+ */
+
+#ifndef _HOST_HAL_H
+#define _HOST_HAL_H
+
+#include <stdint.h>
+
+#define HAL_IO_SIZE		(0x100)
+
+// Register file, indexed by the data space address of the register
+extern uint8_t hal_io[HAL_IO_SIZE];
+
+/**
+ * Clears every register and removes the poll hook.
+ */
+void hal_reset(void);
+
+/**
+ * Runs an interrupt handler like the hardware: the global interrupt 
+ * flag is cleared during the handler and set back by the reti.
+ * 
+ * @param vector The *_vect of the interrupt
+ */
+void hal_interrupt(void (*vector)(void));
+
+/**
+ * Sets the function called by the busy-waits and the sleeps.
+ * 
+ * @param hook Model of the peripheral, NULL for none
+ */
+void hal_setPollHook(void (*hook)(void));
+
+/**
+ * Calls the poll hook, used by the host avr-libc headers.
+ */
+void hal_poll(void);
+
+#endif /* _HOST_HAL_H */
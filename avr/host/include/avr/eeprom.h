@@ -0,0 +1,31 @@
+/**
+ * Host version of avr/eeprom.h, the EEMEM variables are plain memory
+ * and start cleared, like an EEPROM that was never written.
+ */
+
+#ifndef _HOST_EEPROM_H
+#define _HOST_EEPROM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define EEMEM
+
+static inline uint8_t eeprom_read_byte(const uint8_t * addr) {
+	return *addr;
+}
+
+static inline void eeprom_update_byte(uint8_t * addr, uint8_t value) {
+	*addr = value;
+}
+
+static inline void eeprom_read_block(void * dst, const void * src, size_t size) {
+	memcpy(dst, src, size);
+}
+
+static inline void eeprom_update_block(const void * src, void * dst, size_t size) {
+	memcpy(dst, src, size);
+}
+
+#endif /* _HOST_EEPROM_H */
@@ -0,0 +1,43 @@
+/**
+ * Host version of avr/interrupt.h, the handlers are plain functions run
+ * by hal_interrupt() and the global interrupt flag is the I bit of SREG.
+ */
+
+#ifndef _HOST_INTERRUPT_H
+#define _HOST_INTERRUPT_H
+
+#include <avr/io.h>
+
+#define ISR(vector, ...)	void vector(void); void vector(void)
+
+#define sei()	(SREG |= _BV(SREG_I))
+#define cli()	(SREG &= ~_BV(SREG_I))
+
+// Every vector, so a test can trigger one by its *_vect name
+void __vector_1(void);
+void __vector_2(void);
+void __vector_3(void);
+void __vector_4(void);
+void __vector_5(void);
+void __vector_6(void);
+void __vector_7(void);
+void __vector_8(void);
+void __vector_9(void);
+void __vector_10(void);
+void __vector_11(void);
+void __vector_12(void);
+void __vector_13(void);
+void __vector_14(void);
+void __vector_15(void);
+void __vector_16(void);
+void __vector_17(void);
+void __vector_18(void);
+void __vector_19(void);
+void __vector_20(void);
+void __vector_21(void);
+void __vector_22(void);
+void __vector_23(void);
+void __vector_24(void);
+void __vector_25(void);
+
+#endif /* _HOST_INTERRUPT_H */
@@ -0,0 +1,454 @@
+/**
+ * Host version of avr/io.h for the ATmega328P, the registers are mapped
+ * to the simulated register file of hal.h at their data space address.
+ */
+
+#ifndef _HOST_IO_H
+#define _HOST_IO_H
+
+#include <stdint.h>
+#include <avr/sfr_defs.h>
+
+#if !defined(__AVR_ATmega328P__)
+#define __AVR_ATmega328P__
+#endif
+
+#define RAMSTART	(0x100)
+#define RAMEND		(0x8FF)
+#define FLASHEND	(0x7FFF)
+#define E2END		(0x3FF)
+
+/* Registers */
+#define PINB	_SFR_MEM8(0x23)
+#define DDRB	_SFR_MEM8(0x24)
+#define PORTB	_SFR_MEM8(0x25)
+#define PINC	_SFR_MEM8(0x26)
+#define DDRC	_SFR_MEM8(0x27)
+#define PORTC	_SFR_MEM8(0x28)
+#define PIND	_SFR_MEM8(0x29)
+#define DDRD	_SFR_MEM8(0x2A)
+#define PORTD	_SFR_MEM8(0x2B)
+#define TIFR0	_SFR_MEM8(0x35)
+#define TIFR1	_SFR_MEM8(0x36)
+#define TIFR2	_SFR_MEM8(0x37)
+#define PCIFR	_SFR_MEM8(0x3B)
+#define EIFR	_SFR_MEM8(0x3C)
+#define EIMSK	_SFR_MEM8(0x3D)
+#define GPIOR0	_SFR_MEM8(0x3E)
+#define EECR	_SFR_MEM8(0x3F)
+#define EEDR	_SFR_MEM8(0x40)
+#define EEAR	_SFR_MEM16(0x41)
+#define GTCCR	_SFR_MEM8(0x43)
+#define TCCR0A	_SFR_MEM8(0x44)
+#define TCCR0B	_SFR_MEM8(0x45)
+#define TCNT0	_SFR_MEM8(0x46)
+#define OCR0A	_SFR_MEM8(0x47)
+#define OCR0B	_SFR_MEM8(0x48)
+#define GPIOR1	_SFR_MEM8(0x4A)
+#define GPIOR2	_SFR_MEM8(0x4B)
+#define SPCR	_SFR_MEM8(0x4C)
+#define SPSR	_SFR_MEM8(0x4D)
+#define SPDR	_SFR_MEM8(0x4E)
+#define ACSR	_SFR_MEM8(0x50)
+#define SMCR	_SFR_MEM8(0x53)
+#define MCUSR	_SFR_MEM8(0x54)
+#define MCUCR	_SFR_MEM8(0x55)
+#define SPMCSR	_SFR_MEM8(0x57)
+#define SP	_SFR_MEM16(0x5D)
+#define SPL	_SFR_MEM8(0x5D)
+#define SPH	_SFR_MEM8(0x5E)
+#define SREG	_SFR_MEM8(0x5F)
+#define WDTCSR	_SFR_MEM8(0x60)
+#define CLKPR	_SFR_MEM8(0x61)
+#define PRR	_SFR_MEM8(0x64)
+#define OSCCAL	_SFR_MEM8(0x66)
+#define PCICR	_SFR_MEM8(0x68)
+#define EICRA	_SFR_MEM8(0x69)
+#define PCMSK0	_SFR_MEM8(0x6B)
+#define PCMSK1	_SFR_MEM8(0x6C)
+#define PCMSK2	_SFR_MEM8(0x6D)
+#define TIMSK0	_SFR_MEM8(0x6E)
+#define TIMSK1	_SFR_MEM8(0x6F)
+#define TIMSK2	_SFR_MEM8(0x70)
+#define ADC	_SFR_MEM16(0x78)
+#define ADCL	_SFR_MEM8(0x78)
+#define ADCH	_SFR_MEM8(0x79)
+#define ADCSRA	_SFR_MEM8(0x7A)
+#define ADCSRB	_SFR_MEM8(0x7B)
+#define ADMUX	_SFR_MEM8(0x7C)
+#define DIDR0	_SFR_MEM8(0x7E)
+#define DIDR1	_SFR_MEM8(0x7F)
+#define TCCR1A	_SFR_MEM8(0x80)
+#define TCCR1B	_SFR_MEM8(0x81)
+#define TCCR1C	_SFR_MEM8(0x82)
+#define TCNT1	_SFR_MEM16(0x84)
+#define TCNT1L	_SFR_MEM8(0x84)
+#define TCNT1H	_SFR_MEM8(0x85)
+#define ICR1	_SFR_MEM16(0x86)
+#define ICR1L	_SFR_MEM8(0x86)
+#define ICR1H	_SFR_MEM8(0x87)
+#define OCR1A	_SFR_MEM16(0x88)
+#define OCR1AL	_SFR_MEM8(0x88)
+#define OCR1AH	_SFR_MEM8(0x89)
+#define OCR1B	_SFR_MEM16(0x8A)
+#define OCR1BL	_SFR_MEM8(0x8A)
+#define OCR1BH	_SFR_MEM8(0x8B)
+#define TCCR2A	_SFR_MEM8(0xB0)
+#define TCCR2B	_SFR_MEM8(0xB1)
+#define TCNT2	_SFR_MEM8(0xB2)
+#define OCR2A	_SFR_MEM8(0xB3)
+#define OCR2B	_SFR_MEM8(0xB4)
+#define ASSR	_SFR_MEM8(0xB6)
+#define TWBR	_SFR_MEM8(0xB8)
+#define TWSR	_SFR_MEM8(0xB9)
+#define TWAR	_SFR_MEM8(0xBA)
+#define TWDR	_SFR_MEM8(0xBB)
+#define TWCR	_SFR_MEM8(0xBC)
+#define TWAMR	_SFR_MEM8(0xBD)
+#define UCSR0A	_SFR_MEM8(0xC0)
+#define UCSR0B	_SFR_MEM8(0xC1)
+#define UCSR0C	_SFR_MEM8(0xC2)
+#define UBRR0	_SFR_MEM16(0xC4)
+#define UBRR0L	_SFR_MEM8(0xC4)
+#define UBRR0H	_SFR_MEM8(0xC5)
+#define UDR0	_SFR_MEM8(0xC6)
+
+/* Bits */
+// PB
+#define PB0	0
+#define PB1	1
+#define PB2	2
+#define PB3	3
+#define PB4	4
+#define PB5	5
+#define PB6	6
+#define PB7	7
+// PC
+#define PC0	0
+#define PC1	1
+#define PC2	2
+#define PC3	3
+#define PC4	4
+#define PC5	5
+#define PC6	6
+// PD
+#define PD0	0
+#define PD1	1
+#define PD2	2
+#define PD3	3
+#define PD4	4
+#define PD5	5
+#define PD6	6
+#define PD7	7
+// DDRB
+#define DDB0	0
+#define DDB1	1
+#define DDB2	2
+#define DDB3	3
+#define DDB4	4
+#define DDB5	5
+#define DDB6	6
+#define DDB7	7
+// DDRC
+#define DDC0	0
+#define DDC1	1
+#define DDC2	2
+#define DDC3	3
+#define DDC4	4
+#define DDC5	5
+#define DDC6	6
+// DDRD
+#define DDD0	0
+#define DDD1	1
+#define DDD2	2
+#define DDD3	3
+#define DDD4	4
+#define DDD5	5
+#define DDD6	6
+#define DDD7	7
+// TCCR0A
+#define WGM00	0
+#define WGM01	1
+#define COM0B0	4
+#define COM0B1	5
+#define COM0A0	6
+#define COM0A1	7
+// TCCR0B
+#define CS00	0
+#define CS01	1
+#define CS02	2
+#define WGM02	3
+#define FOC0B	6
+#define FOC0A	7
+// TIMSK0
+#define TOIE0	0
+#define OCIE0A	1
+#define OCIE0B	2
+// TIFR0
+#define TOV0	0
+#define OCF0A	1
+#define OCF0B	2
+// TCCR1A
+#define WGM10	0
+#define WGM11	1
+#define COM1B0	4
+#define COM1B1	5
+#define COM1A0	6
+#define COM1A1	7
+// TCCR1B
+#define CS10	0
+#define CS11	1
+#define CS12	2
+#define WGM12	3
+#define WGM13	4
+#define ICES1	6
+#define ICNC1	7
+// TCCR1C
+#define FOC1B	6
+#define FOC1A	7
+// TIMSK1
+#define TOIE1	0
+#define OCIE1A	1
+#define OCIE1B	2
+#define ICIE1	5
+// TIFR1
+#define TOV1	0
+#define OCF1A	1
+#define OCF1B	2
+#define ICF1	5
+// TCCR2A
+#define WGM20	0
+#define WGM21	1
+#define COM2B0	4
+#define COM2B1	5
+#define COM2A0	6
+#define COM2A1	7
+// TCCR2B
+#define CS20	0
+#define CS21	1
+#define CS22	2
+#define WGM22	3
+#define FOC2B	6
+#define FOC2A	7
+// TIMSK2
+#define TOIE2	0
+#define OCIE2A	1
+#define OCIE2B	2
+// TIFR2
+#define TOV2	0
+#define OCF2A	1
+#define OCF2B	2
+// EICRA
+#define ISC00	0
+#define ISC01	1
+#define ISC10	2
+#define ISC11	3
+// EIMSK
+#define INT0	0
+#define INT1	1
+// EIFR
+#define INTF0	0
+#define INTF1	1
+// PCICR
+#define PCIE0	0
+#define PCIE1	1
+#define PCIE2	2
+// PCIFR
+#define PCIF0	0
+#define PCIF1	1
+#define PCIF2	2
+// PCMSK0
+#define PCINT0	0
+#define PCINT1	1
+#define PCINT2	2
+#define PCINT3	3
+#define PCINT4	4
+#define PCINT5	5
+#define PCINT6	6
+#define PCINT7	7
+// PCMSK1
+#define PCINT8	0
+#define PCINT9	1
+#define PCINT10	2
+#define PCINT11	3
+#define PCINT12	4
+#define PCINT13	5
+#define PCINT14	6
+// PCMSK2
+#define PCINT16	0
+#define PCINT17	1
+#define PCINT18	2
+#define PCINT19	3
+#define PCINT20	4
+#define PCINT21	5
+#define PCINT22	6
+#define PCINT23	7
+// SPCR
+#define SPR0	0
+#define SPR1	1
+#define CPHA	2
+#define CPOL	3
+#define MSTR	4
+#define DORD	5
+#define SPE	6
+#define SPIE	7
+// SPSR
+#define SPI2X	0
+#define WCOL	6
+#define SPIF	7
+// TWCR
+#define TWIE	0
+#define TWEN	2
+#define TWWC	3
+#define TWSTO	4
+#define TWSTA	5
+#define TWEA	6
+#define TWINT	7
+// TWSR
+#define TWPS0	0
+#define TWPS1	1
+// TWAR
+#define TWGCE	0
+// UCSR0A
+#define MPCM0	0
+#define U2X0	1
+#define UPE0	2
+#define DOR0	3
+#define FE0	4
+#define UDRE0	5
+#define TXC0	6
+#define RXC0	7
+// UCSR0B
+#define TXB80	0
+#define RXB80	1
+#define UCSZ02	2
+#define TXEN0	3
+#define RXEN0	4
+#define UDRIE0	5
+#define TXCIE0	6
+#define RXCIE0	7
+// UCSR0C
+#define UCPOL0	0
+#define UCSZ00	1
+#define UCSZ01	2
+#define USBS0	3
+#define UPM00	4
+#define UPM01	5
+#define UMSEL00	6
+#define UMSEL01	7
+// MCUSR
+#define PORF	0
+#define EXTRF	1
+#define BORF	2
+#define WDRF	3
+// MCUCR
+#define IVCE	0
+#define IVSEL	1
+#define PUD	4
+#define BODSE	5
+#define BODS	6
+// SMCR
+#define SE	0
+#define SM0	1
+#define SM1	2
+#define SM2	3
+// PRR
+#define PRADC	0
+#define PRUSART01
+#define PRSPI	2
+#define PRTIM1	3
+#define PRTIM0	5
+#define PRTIM2	6
+#define PRTWI	7
+// WDTCSR
+#define WDP0	0
+#define WDP1	1
+#define WDP2	2
+#define WDE	3
+#define WDCE	4
+#define WDP3	5
+#define WDIE	6
+#define WDIF	7
+// ADCSRA
+#define ADPS0	0
+#define ADPS1	1
+#define ADPS2	2
+#define ADIE	3
+#define ADIF	4
+#define ADATE	5
+#define ADSC	6
+#define ADEN	7
+// ACSR
+#define ACIS0	0
+#define ACIS1	1
+#define ACIC	2
+#define ACIE	3
+#define ACI	4
+#define ACO	5
+#define ACBG	6
+#define ACD	7
+// SREG
+#define SREG_C	0
+#define SREG_Z	1
+#define SREG_N	2
+#define SREG_V	3
+#define SREG_S	4
+#define SREG_H	5
+#define SREG_T	6
+#define SREG_I	7
+
+/* Interrupt vectors, see avr/interrupt.h */
+#define _VECTOR(N)	__vector_ ## N
+#define INT0_vect	_VECTOR(1)
+#define INT0_vect_num	(1)
+#define INT1_vect	_VECTOR(2)
+#define INT1_vect_num	(2)
+#define PCINT0_vect	_VECTOR(3)
+#define PCINT0_vect_num	(3)
+#define PCINT1_vect	_VECTOR(4)
+#define PCINT1_vect_num	(4)
+#define PCINT2_vect	_VECTOR(5)
+#define PCINT2_vect_num	(5)
+#define WDT_vect	_VECTOR(6)
+#define WDT_vect_num	(6)
+#define TIMER2_COMPA_vect	_VECTOR(7)
+#define TIMER2_COMPA_vect_num	(7)
+#define TIMER2_COMPB_vect	_VECTOR(8)
+#define TIMER2_COMPB_vect_num	(8)
+#define TIMER2_OVF_vect	_VECTOR(9)
+#define TIMER2_OVF_vect_num	(9)
+#define TIMER1_CAPT_vect	_VECTOR(10)
+#define TIMER1_CAPT_vect_num	(10)
+#define TIMER1_COMPA_vect	_VECTOR(11)
+#define TIMER1_COMPA_vect_num	(11)
+#define TIMER1_COMPB_vect	_VECTOR(12)
+#define TIMER1_COMPB_vect_num	(12)
+#define TIMER1_OVF_vect	_VECTOR(13)
+#define TIMER1_OVF_vect_num	(13)
+#define TIMER0_COMPA_vect	_VECTOR(14)
+#define TIMER0_COMPA_vect_num	(14)
+#define TIMER0_COMPB_vect	_VECTOR(15)
+#define TIMER0_COMPB_vect_num	(15)
+#define TIMER0_OVF_vect	_VECTOR(16)
+#define TIMER0_OVF_vect_num	(16)
+#define SPI_STC_vect	_VECTOR(17)
+#define SPI_STC_vect_num	(17)
+#define USART_RX_vect	_VECTOR(18)
+#define USART_RX_vect_num	(18)
+#define USART_UDRE_vect	_VECTOR(19)
+#define USART_UDRE_vect_num	(19)
+#define USART_TX_vect	_VECTOR(20)
+#define USART_TX_vect_num	(20)
+#define ADC_vect	_VECTOR(21)
+#define ADC_vect_num	(21)
+#define EE_READY_vect	_VECTOR(22)
+#define EE_READY_vect_num	(22)
+#define ANALOG_COMP_vect	_VECTOR(23)
+#define ANALOG_COMP_vect_num	(23)
+#define TWI_vect	_VECTOR(24)
+#define TWI_vect_num	(24)
+#define SPM_READY_vect	_VECTOR(25)
+#define SPM_READY_vect_num	(25)
+#define _VECTORS_SIZE	(26 * 4)
+
+#endif /* _HOST_IO_H */
@@ -0,0 +1,30 @@
+/**
+ * Host version of avr/pgmspace.h, the host has a single address space
+ * and the program memory variants are the standard functions.
+ */
+
+#ifndef _HOST_PGMSPACE_H
+#define _HOST_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P			const char *
+#define PSTR(s)			(s)
+
+#define pgm_read_byte(addr)		(*(const uint8_t *) (addr))
+#define pgm_read_word(addr)		(*(const uint16_t *) (addr))
+#define pgm_read_dword(addr)	(*(const uint32_t *) (addr))
+
+#define memcpy_P		memcpy
+#define strcmp_P		strcmp
+#define strncmp_P		strncmp
+#define strlen_P		strlen
+#define strcpy_P		strcpy
+
+#define fprintf_P		fprintf
+#define printf_P		printf
+#define snprintf_P		snprintf
+
+#endif /* _HOST_PGMSPACE_H */
@@ -0,0 +1,33 @@
+/**
+ * Host version of avr-libc's sfr_defs.h, the registers are bytes of 
+ * hal_io and the busy-waits call the poll hook, see hal.h.
+ */
+
+#ifndef _HOST_SFR_DEFS_H
+#define _HOST_SFR_DEFS_H
+
+#include <stdint.h>
+#include "hal.h"
+
+#define __SFR_OFFSET	(0x20)
+
+#define _MMIO_BYTE(addr)	(*(volatile uint8_t *) (hal_io + (addr)))
+#define _MMIO_WORD(addr)	(*(volatile uint16_t *) (hal_io + (addr)))
+
+#define _SFR_MEM8(addr)		_MMIO_BYTE(addr)
+#define _SFR_MEM16(addr)	_MMIO_WORD(addr)
+#define _SFR_IO8(addr)		_MMIO_BYTE((addr) + __SFR_OFFSET)
+#define _SFR_IO16(addr)		_MMIO_WORD((addr) + __SFR_OFFSET)
+
+#define _SFR_MEM_ADDR(sfr)	((uint16_t) ((volatile uint8_t *) &(sfr) - hal_io))
+#define _SFR_IO_ADDR(sfr)	(_SFR_MEM_ADDR(sfr) - __SFR_OFFSET)
+
+#define _BV(bit)			(1 << (bit))
+
+#define bit_is_set(sfr, bit)	((sfr) & _BV(bit))
+#define bit_is_clear(sfr, bit)	(!((sfr) & _BV(bit)))
+
+#define loop_until_bit_is_set(sfr, bit)		do { hal_poll(); } while (bit_is_clear(sfr, bit))
+#define loop_until_bit_is_clear(sfr, bit)	do { hal_poll(); } while (bit_is_set(sfr, bit))
+
+#endif /* _HOST_SFR_DEFS_H */
@@ -0,0 +1,22 @@
+/**
+ * Host version of avr/sleep.h, sleep_cpu() calls the poll hook where a
+ * test can raise the interrupt that wakes the CPU, see hal.h.
+ */
+
+#ifndef _HOST_SLEEP_H
+#define _HOST_SLEEP_H
+
+#include <avr/io.h>
+
+#define SLEEP_MODE_IDLE			(0)
+#define SLEEP_MODE_ADC			(_BV(SM0))
+#define SLEEP_MODE_PWR_DOWN		(_BV(SM1))
+#define SLEEP_MODE_PWR_SAVE		(_BV(SM0) | _BV(SM1))
+#define SLEEP_MODE_STANDBY		(_BV(SM1) | _BV(SM2))
+
+#define set_sleep_mode(mode)	(SMCR = (SMCR & ~(_BV(SM0) | _BV(SM1) | _BV(SM2))) | (mode))
+#define sleep_enable()			(SMCR |= _BV(SE))
+#define sleep_disable()			(SMCR &= ~_BV(SE))
+#define sleep_cpu()				hal_poll()
+
+#endif /* _HOST_SLEEP_H */
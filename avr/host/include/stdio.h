@@ -0,0 +1,17 @@
+/**
+ * Host wrapper of stdio.h for the avr-libc stream setup of uart.c, the 
+ * streams are never written on the host.
+ */
+
+#ifndef _HOST_STDIO_H
+#define _HOST_STDIO_H
+
+#include_next <stdio.h>
+
+#define _FDEV_SETUP_READ	(1)
+#define _FDEV_SETUP_WRITE	(2)
+#define _FDEV_SETUP_RW		(3)
+
+#define FDEV_SETUP_STREAM(put, get, rwflag)	{0}
+
+#endif /* _HOST_STDIO_H */
@@ -0,0 +1,31 @@
+/**
+ * Host version of util/atomic.h, the blocks clear and restore the I bit 
+ * of the simulated SREG like avr-libc.
+ */
+
+#ifndef _HOST_ATOMIC_H
+#define _HOST_ATOMIC_H
+
+#include <stdint.h>
+#include <avr/io.h>
+
+static inline uint8_t __iCliRetVal(void) {
+	SREG &= ~_BV(SREG_I);
+	return 1;
+}
+
+static inline void __iSeiParam(const uint8_t * __s) {
+	SREG |= _BV(SREG_I);
+	(void) __s;
+}
+
+static inline void __iRestore(const uint8_t * __s) {
+	SREG = *__s;
+}
+
+#define ATOMIC_BLOCK(type)	for (type, __ToDo = __iCliRetVal(); __ToDo; __ToDo = 0)
+
+#define ATOMIC_RESTORESTATE	uint8_t sreg_save __attribute__((__cleanup__(__iRestore))) = SREG
+#define ATOMIC_FORCEON		uint8_t sreg_save __attribute__((__cleanup__(__iSeiParam))) = 0
+
+#endif /* _HOST_ATOMIC_H */
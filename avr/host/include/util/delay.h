@@ -0,0 +1,13 @@
+/**
+ * Host version of util/delay.h, the delays return at once.
+ */
+
+#ifndef _HOST_DELAY_H
+#define _HOST_DELAY_H
+
+#include <util/delay_basic.h>
+
+#define _delay_ms(ms)	((void) (ms))
+#define _delay_us(us)	((void) (us))
+
+#endif /* _HOST_DELAY_H */
@@ -0,0 +1,18 @@
+/**
+ * Host version of util/delay_basic.h, the delays return at once.
+ */
+
+#ifndef _HOST_DELAY_BASIC_H
+#define _HOST_DELAY_BASIC_H
+
+#include <stdint.h>
+
+static inline void _delay_loop_1(uint8_t count) {
+	(void) count;
+}
+
+static inline void _delay_loop_2(uint16_t count) {
+	(void) count;
+}
+
+#endif /* _HOST_DELAY_BASIC_H */
@@ -3,7 +3,14 @@
  * lsm303.h acceleremoter.
  * 
  * This module will respond to a rising edge on the on external pin 0 when
- * it is ARMED. 
+ * it is ARMED. The samples following the edge are classified by the
+ * vibration.h module and only Lift, Pry or Drop patterns raise the alert. 
+ * The orientation.h module also raises the alert if the box is tilted or
+ * moved from its orientation at arm time.
+ * 
+ * The LSM303 click and 6D engines are routed on INT2 to a pin change 
+ * interrupt (ACCEL_INT2_*). A 6D orientation change raises the alert, a 
+ * double click starts a classification window like the threshold event.
  * 
  * This module is directly tied to the lsm303.h driver to control the
  * LSM303LDHC interrupt and status clear.
@@ -13,26 +20,120 @@
 #define _DEV_ALERT_H
 
 #include "pin_config.h"
+#include "vibration.h"
+#include "lsm303.h"
+#include "calibration.h"
+#include "event.h"
+#include "trace.h"
+#include <stdbool.h>
+
+/**
+ * Main loop event, alert_run() has work to do.
+ */
+#define EVENT_ALERT					EVENT_USER(1)
 
+/**
+ * Trace ids, see trace.h.
+ */
+#define TRACE_ALERT_INT				TRACE_USER(0x20)	// arg is the LSM303 pin, 1 or 2
+#define TRACE_ALERT_STATE			TRACE_USER(0x21)	// arg is the new state
+#define TRACE_ALERT_CLASS			TRACE_USER(0x22)	// arg is the vibration_class
+
+/**
+ * Settle delay at boot when the calibration failed.
+ */
 #define ALERT_INIT_DELAY_MS			(1500)
 
+/**
+ * Settle delay at boot when a calibration is stored in EEPROM.
+ */
+#define ALERT_INIT_FAST_DELAY_MS	(100)
+
+/**
+ * Quiet time after an intruder alert before the alert can be raised again.
+ */
+#define ALERT_QUIET_PERIOD_MS		(5000)
+
 #define ALERT_RUN_ARMED				(10)
 #define ALERT_RUN_DISARM			(11)
 
 /**
  * Sets the LSM303 Threshold for High interrupt event.
+ * 
+ * This is the default and the lowest threshold set by the calibration.
  */
 #define ALERT_ACCEL_THRESHOLD		(4)
 
 /**
- * Sets the LSM303 Duration of a High event for interrupt.
+ * Sets the LSM303 Duration of a High event for interrupt, in ODR periods
+ * of the armed profile.
+ * 
+ * This is the default and the lowest duration set by the calibration.
+ */
+#define ALERT_ACCEL_DURATION 		(8)
+
+/**
+ * Number of standard deviations of the calibrated threshold over the 
+ * noise floor.
+ */
+#if !defined(ALERT_CALIBRATION_SIGMAS)
+#define ALERT_CALIBRATION_SIGMAS	(6)
+#endif
+
+/**
+ * Sampling period of the calibration, one ODR period of the armed profile.
+ */
+#define ALERT_CALIBRATION_SAMPLE_MS	(10)
+
+/**
+ * Accelerometer profiles, alert_run() switches automatically between them
+ * from the alert state.
+ * 
+ * 	DISARMED: Low power mode at a low rate, nothing is sampled.
+ * 	ARMED: High resolution for the threshold, click and 6D engines.
+ * 	FORENSIC: High rate burst while a vibration window is classified.
+ */
+#define ALERT_PROFILE_DISARMED		(0)
+#define ALERT_PROFILE_ARMED			(1)
+#define ALERT_PROFILE_FORENSIC		(2)
+
+#define ALERT_ACCEL_SCALE			(LSM303_FS_4G)
+#define ALERT_DISARMED_DATA_RATE	(LSM303_DATA_RATE_10HZ)
+#define ALERT_ARMED_DATA_RATE		(LSM303_DATA_RATE_100HZ)
+#define ALERT_FORENSIC_DATA_RATE	(LSM303_DATA_RATE_400HZ)
+
+/**
+ * Sampling periods of the profiles, from a timer. The samples are read 
+ * only when the LSM303 has new data.
+ */
+#define ALERT_ARMED_SAMPLE_MS		(10)
+#define ALERT_FORENSIC_SAMPLE_MS	(2)
+
+/**
+ * Click engine configuration, in LSM303_FS_4G click threshold units
+ * (~32mg) and ODR periods of the armed profile for the timings. The
+ * threshold applies to the high-passed data, see lsm303_set_click(), so
+ * the Z axis is usable with gravity on it.
  */
-#define ALERT_ACCEL_DURATION 		(2)
+#define ALERT_CLICK_AXES			(LSM303_CLICK_XD | LSM303_CLICK_YD | LSM303_CLICK_ZD)
+#define ALERT_CLICK_THRESHOLD		(24)
+#define ALERT_CLICK_TIME_LIMIT		(3)
+#define ALERT_CLICK_LATENCY			(8)
+#define ALERT_CLICK_WINDOW			(30)
+
+/**
+ * 6D orientation interrupt configuration (~32mg/LSB and ODR periods of
+ * the armed profile).
+ */
+#define ALERT_6D_THRESHOLD			(22)
+#define ALERT_6D_DURATION			(10)
 
 /**
  * Set the alert as enabled or disabled.
  * 
- * This can be called either once, on event or at each work loop iteration.
+ * This must be called on EVENT_ALERT and when the run status changes, it
+ * can also be called at each work loop iteration. The samples are read
+ * from a timerwheel.h timer while armed.
  * 
  * @param run ALERT_RUN_ARMED/ALERT_RUN_DISARM
  */
@@ -45,12 +146,64 @@ void alert_run(uint8_t runStatus);
  */ 
 uint8_t alert_getstatus();
 
+/**
+ * Retrieves the current accelerometer profile.
+ * 
+ * @returns ALERT_PROFILE_*
+ */
+uint8_t alert_getProfile();
+
+/**
+ * Retrieves the result of the last vibration classification.
+ * 
+ * @param features Output for the features of the last window, can be NULL.
+ * @returns VIBRATION_CLASS_*
+ */
+uint8_t alert_getLastClass(struct vibration_features * features);
+
 /**
  * Initializes the alert module and the LSM303 driver.
  * 
+ * The systick.h timebase must be running.
+ * 
+ * The LSM303 settles in the background, alert_run() does nothing until
+ * alert_isReady(). The threshold calibration is loaded from EEPROM or 
+ * started with alert_calibrate() if none is stored, the box must be at
+ * rest. The alert is ready at the end of the calibration. A failed boot
+ * calibration stores the defaults with CALIBRATION_FLAG_DEFAULTS, the 
+ * next boots don't repeat it.
+ * 
  * <p>
  * Note: This will not ARM the alert.
  */
 int alert_init();
 
+/**
+ * Checks whether the LSM303 has settled after alert_init().
+ * 
+ * @return true once the alert can be armed
+ */
+bool alert_isReady();
+
+/**
+ * Starts the calibration of the LSM303 threshold interrupt on the current
+ * noise floor, it is stored for the next boot.
+ * 
+ * The readings are fed from a timer for about a second, alert_run() is 
+ * held until the end. On failure the default ALERT_ACCEL_THRESHOLD/DURATION
+ * are used.
+ * 
+ * @return false if a calibration is running or the alert is armed
+ */
+bool alert_calibrate();
+
+/**
+ * Retrieves the calibration in use.
+ * 
+ * @param result Output of the calibration
+ * @return CALIBRATION_BUSY while a calibration runs, then the status of 
+ * 		the last one
+ */
+int alert_getCalibration(struct calibration_result * result);
+
 #endif /* _DEV_ALERT_H */
@@ -2,7 +2,10 @@
 #define _DEV_BOX_CONTROL_H
 
 #include "servo.h"
+#include "event.h"
+#include "trace.h"
 #include <avr/io.h>
+#include <stdbool.h>
 
 #define LID_MOTOR SERVO_CHANNELA
 #define LOCK_MOTOR SERVO_CHANNELB
@@ -15,11 +18,60 @@
 #define LID_CLOSED_POSITION 180
 #define LID_OPEN_POSITION 30
 
+// Lock position where the latch clears the lid, the lid can start opening
+#define LOCK_CLEAR_POSITION 60
+
+// Motion profiles, velocity in degrees/s and acceleration in degrees/s^2
+#define LOCK_VELOCITY 285 // 0.21 s / 60 deg
+#define LOCK_ACCELERATION 3000
+#define LID_VELOCITY 120
+#define LID_ACCELERATION 400
+
+// Time the servos are held after a move before they are detached, in ms.
+// The lid is only detached when closed, it holds itself open.
+#define LOCK_HOLD_MS 500
+#define LID_CLOSED_HOLD_MS 1000
+
+// Lid back-off before closing again after a jammed close
+#define LID_RETRY_BACKOFF 30
+
+// Deadlines of the moving states in ms, and retries before a fault
+#define BOX_UNLOCK_DEADLINE_MS 1000
+#define BOX_OPEN_DEADLINE_MS 3000
+#define BOX_CLOSE_DEADLINE_MS 4000
+#define BOX_LOCK_DEADLINE_MS 1000
+#define BOX_RETRIES 2
+
+// Time the reed switch must be stable before an edge is published
+#define BOX_SWITCH_DEBOUNCE_MS 20
+
 #define BOX_STATE_IDLE_OPEN     0x01
-#define BOX_STATE_PENDING_OPEN  0x02
+#define BOX_STATE_OPENING       0x02
 #define BOX_STATE_IDLE_CLOSED   0x03
-#define BOX_STATE_PENDING_CLOSE 0x04
-#define BOX_STATUS_QUERY        0x05
+#define BOX_STATE_LOCKING       0x04
+#define BOX_STATE_UNLOCKING     0x06
+#define BOX_STATE_CLOSING       0x07
+#define BOX_STATE_FAULT         0x08
+#define BOX_STATE_ANY           0xFE
+
+// Main loop event, box_handleCurrentState() has work to do
+#define EVENT_BOX EVENT_USER(0)
+
+// Events of the box state machine, in order of handling
+#define BOX_EVENT_CMD_OPEN      0
+#define BOX_EVENT_CMD_CLOSE     1
+#define BOX_EVENT_CMD_QUERY     2
+#define BOX_EVENT_LID_OPENED    3
+#define BOX_EVENT_LID_CLOSED    4
+#define BOX_EVENT_LOCK_CLEAR    5
+#define BOX_EVENT_LOCK_DONE     6
+#define BOX_EVENT_LID_DONE      7
+#define BOX_EVENT_TIMEOUT       8
+
+// Trace ids, see trace.h
+#define TRACE_BOX_EVENT         TRACE_USER(0x00)    // arg is BOX_EVENT_*
+#define TRACE_BOX_STATE         TRACE_USER(0x01)    // arg is the new BOX_STATE_*
+#define TRACE_BOX_FAULT         TRACE_USER(0x02)    // arg is the BOX_STATE_* that failed
 
 /**
  * Initializes the box for use by preparing its motors
@@ -27,7 +79,9 @@
 int box_init();
 
 /**
- * Will unlock the box, if the box is closed
+ * Will start to unlock the box, if the box is closed
+ * 
+ * The lock motion is completed in the background, see motion.h
  * @return 0 if success, negative if failure
  */
 int box_unlock();
@@ -50,12 +104,31 @@ int box_close();
  */
 int box_open();
 
+/**
+ * Checks whether the box reached a known idle state after box_init().
+ * 
+ * The box is ready at once if the lid is closed, otherwise once the lid
+ * closed and locked in the background, or failed to.
+ * @return true if ready
+ */
+bool box_isReady();
+
 /**
  * Checks whether or not the box is open
+ * 
+ * This is the debounced state of the reed switch, it only changes in
+ * box_handleCurrentState() once the switch has been stable for
+ * BOX_SWITCH_DEBOUNCE_MS.
  * @return 1 if open, 0 if not
  */
 int box_isOpen();
 
+/**
+ * Returns the time of the last debounced edge of the reed switch
+ * @return systick_millis() at the first bounce of the edge
+ */
+uint32_t box_lastSwitchEdge();
+
 /**
  * Checks whether or not the box is closed
  * @return 1 if closed, 0 if open
@@ -66,24 +139,33 @@ int box_isClosed();
  * Returns the state that the box is in
  * 
  * BOX_STATE_IDLE_OPEN     0x01
- * BOX_STATE_PENDING_OPEN  0x02
+ * BOX_STATE_OPENING       0x02
  * BOX_STATE_IDLE_CLOSED   0x03
- * BOX_STATE_PENDING_CLOSE 0x04
+ * BOX_STATE_LOCKING       0x04
+ * BOX_STATE_UNLOCKING     0x06
+ * BOX_STATE_CLOSING       0x07
+ * BOX_STATE_FAULT         0x08
  */
 int box_getState();
 
 /**
- * Sets the state that the box is in
+ * Posts an event to the box state machine, it is handled on the next 
+ * call to box_handleCurrentState(). EVENT_BOX is posted to the main loop.
  * 
- * BOX_STATE_IDLE_OPEN     0x01
- * BOX_STATE_PENDING_OPEN  0x02
- * BOX_STATE_IDLE_CLOSED   0x03
- * BOX_STATE_PENDING_CLOSE 0x04
+ * Can be called from an interrupt.
+ * 
+ * @param event BOX_EVENT_*
  */
-void box_setState(uint8_t newState);
+void box_postEvent(uint8_t event);
 
 /**
- * Tells the box to take care of the state that it is currently in.
+ * Tells the box to handle the events posted since the last call.
+ * 
+ * Each transition of the box is driven by an event: a command, an edge
+ * of the reed switch, the end of a servo move or a timeout. A moving 
+ * state that doesn't reach its next transition within its deadline 
+ * retries its action, then goes to BOX_STATE_FAULT and sends 
+ * SPICMD_BBB_BOX_FAULT. A command gets the box out of the fault state.
  */ 
 void box_handleCurrentState();
 
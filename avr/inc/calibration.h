@@ -0,0 +1,113 @@
+/**
+ * Noise floor calibration of the LSM303 threshold interrupt.
+ * 
+ * The accelerometer is sampled for a bounded window with the box at rest
+ * to compute the mean and standard deviation of each axis. The INT1 
+ * threshold is set at a number of sigmas over the X/Y floor and the 
+ * duration over the longest noise burst seen in a verification window.
+ * 
+ * The calibration is incremental: calibration_start() resets the sums and
+ * the caller feeds one reading per sampling period with calibration_feed(),
+ * typically from a timerwheel.h timer, so the main loop keeps running.
+ * 
+ * The result is stored in EEPROM so the next boot can reuse it instead of
+ * waiting for the sensor to settle and sampling again.
+ */
+
+#ifndef _DEV_CALIBRATION_H
+#define _DEV_CALIBRATION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lsm303.h"
+
+/**
+ * Samples dropped while the sensor settles before the statistics.
+ */
+#define CALIBRATION_DISCARD_SAMPLES		(25)
+
+/**
+ * Samples of the statistics window, must be a power of 2.
+ */
+#define CALIBRATION_SAMPLES				(64)
+#define CALIBRATION_SAMPLES_SHIFT		(6)
+
+/**
+ * Samples of the verification window for the noise bursts duration.
+ */
+#define CALIBRATION_VERIFY_SAMPLES		(32)
+
+/**
+ * Consecutive feeds without new data before the calibration is aborted.
+ */
+#define CALIBRATION_MAX_MISSED			(10)
+
+/**
+ * Raw reading LSB per INT1_THS LSB at LSM303_FS_4G (32mg / 2mg).
+ */
+#define CALIBRATION_THS_RAW_LSB			(16)
+
+#define CALIBRATION_OK					(0)
+#define CALIBRATION_BUSY				(1)
+#define CALIBRATION_ERR_TIMEOUT			(-1)
+
+/**
+ * calibration_result flags.
+ */
+#define CALIBRATION_FLAG_DEFAULTS		(0x01)	// Defaults stored after a failed calibration
+
+struct calibration_result {
+	int16_t mean[3];
+	uint16_t sigma[3];
+	uint8_t threshold;
+	uint8_t duration;
+	uint8_t flags;
+};
+
+/**
+ * Starts a calibration, any calibration in progress is restarted.
+ * 
+ * The LSM303 must be initialized and at rest.
+ * 
+ * @param sigmas Number of standard deviations of the threshold over the floor
+ * @param minThreshold Lowest INT1 threshold allowed
+ * @param minDuration Lowest INT1 duration allowed
+ */
+void calibration_start(uint8_t sigmas, uint8_t minThreshold, uint8_t minDuration);
+
+/**
+ * Feeds the reading of one sampling period, a reading without new data 
+ * counts as missed.
+ * 
+ * Usage:
+ * 		lsm303_read(&reading);
+ * 		status = calibration_feed(&reading, &result);
+ * 
+ * @param reading Reading of lsm303_read()
+ * @param result Output of the calibration, set on CALIBRATION_OK
+ * @return CALIBRATION_BUSY until the last window is done, then 
+ * 		CALIBRATION_OK or CALIBRATION_ERR_*
+ */
+int calibration_feed(const struct lsm303_accel_reading * reading, struct calibration_result * result);
+
+/**
+ * Loads the calibration stored in EEPROM.
+ * 
+ * @param result Output of the stored calibration
+ * @return true if a valid calibration was found
+ */
+bool calibration_load(struct calibration_result * result);
+
+/**
+ * Stores the calibration in EEPROM for the next boot.
+ * 
+ * @param result Calibration to store
+ */
+void calibration_store(const struct calibration_result * result);
+
+/**
+ * Invalidates the calibration stored in EEPROM.
+ */
+void calibration_clear();
+
+#endif /* _DEV_CALIBRATION_H */
@@ -0,0 +1,80 @@
+/**
+ * Health counters of the firmware for the BBB.
+ * 
+ * The counters of the modules are gathered every second by 
+ * health_update() into a struct health_block the BBB reads with the 
+ * SPICMD_BLOCK_HEALTH block of spi_command.h. The heartbeat only moves
+ * when the main loop runs, a BBB that reads the same heartbeat for a 
+ * few seconds knows the AVR is wedged even if the SPI interrupt still
+ * answers.
+ * 
+ * The ready flags are read when the BBB requests the block, so it can
+ * poll the end of the background initialization.
+ * 
+ * The reset cause is MCUSR at boot, or the copy left in r2 by optiboot
+ * that clears MCUSR before starting the firmware.
+ */
+
+#ifndef _DEV_HEALTH_H
+#define _DEV_HEALTH_H
+
+#include <stdint.h>
+
+#define HEALTH_VERSION		(3)
+
+#define HEALTH_READY_BOX	(0x01)	// box_isReady()
+#define HEALTH_READY_ALERT	(0x02)	// alert_isReady()
+
+// Period of health_update()
+#define HEALTH_PERIOD_MS	(1000)
+
+// ISRPROF_VECTORS, isrprof.h is not included for the simavr harness
+#define HEALTH_ISR_VECTORS	(10)
+
+struct health_block {
+	uint32_t uptime;			// Seconds since boot
+	uint16_t heartbeat;			// Incremented by every health_update()
+	uint16_t loopsPerSecond;	// Main loop iterations in the last period
+	uint32_t wakeups;			// Sleeps of the main loop, since boot
+	uint32_t spiBytes;			// Bytes shifted by the BBB
+	uint16_t spiDesyncs;		// Unknown SPI commands
+	uint16_t spiQueueFull;		// Commands to the BBB dropped
+	uint16_t workDropped;		// Deferred work dropped, see workqueue.h
+	uint16_t uartOverruns;		// Received bytes dropped, 0 without the console
+	uint16_t i2cErrors;			// Failed I2C transactions
+	uint16_t stackUnused;		// Stack never used since boot, see memstat.h
+	uint16_t linkUpMs;			// Boot to the SPI link ready
+	uint16_t firstSpiMs;		// Boot to the first SPI byte, 0 before
+	uint16_t isrHits[HEALTH_ISR_VECTORS];	// Hits of each ISRPROF_* vector in the last period
+	uint8_t resetCause;			// MCUSR at boot
+	uint8_t ready;				// HEALTH_READY_*, live
+	uint8_t version;			// HEALTH_VERSION
+};
+
+/**
+ * Registers the health block with spi_command, spicmd_init() must have
+ * been called.
+ * 
+ * Called as soon as the link is up, it stamps linkUpMs.
+ */
+void health_init();
+
+/**
+ * Counts an iteration of the main loop.
+ */
+void health_loop();
+
+/**
+ * Gathers the counters and publishes the block, must be called every 
+ * HEALTH_PERIOD_MS.
+ */
+void health_update();
+
+/**
+ * Retrieves the last published block.
+ * 
+ * @param block Output for the block
+ */
+void health_get(struct health_block * block);
+
+#endif /* _DEV_HEALTH_H */
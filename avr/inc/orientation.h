@@ -0,0 +1,60 @@
+/**
+ * Orientation tracking of the box from the accelerometer gravity vector.
+ * 
+ * The pitch and roll of each sample are computed with the integer
+ * cordic.h kernel and compared to a reference captured on the first
+ * sample after a reset (arm time). The box is flagged as moved when the
+ * difference stays over the threshold for ORIENTATION_MOVED_MS, the time
+ * is counted with the sample period so it does not depend on the rate.
+ */
+
+#ifndef _DEV_ORIENTATION_H
+#define _DEV_ORIENTATION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Pitch or roll difference from the reference flagged as moved, in
+ * tenths of a degree.
+ */
+#define ORIENTATION_MOVED_THRESHOLD		(150)
+
+/**
+ * Time over the threshold before the box is flagged as moved, in ms.
+ * 
+ * Longer than the acceleration of a shock, which tilts the measured
+ * gravity vector for a few tens of ms.
+ */
+#define ORIENTATION_MOVED_MS			(160)
+
+struct orientation_angles {
+	int16_t pitch;
+	int16_t roll;
+};
+
+/**
+ * Invalidates the reference orientation, the next sample will be the
+ * new reference.
+ */
+void orientation_reset();
+
+/**
+ * Updates the orientation with a new accelerometer sample.
+ * 
+ * @param x, y, z Raw accelerometer reading
+ * @param period Time since the previous sample in ms
+ * @return true if the box has been tilted or moved from the reference
+ */
+bool orientation_update(int16_t x, int16_t y, int16_t z, uint8_t period);
+
+/**
+ * Retrieves the last and reference orientations.
+ * 
+ * @param current Output for the last sample orientation, can be NULL.
+ * @param reference Output for the reference orientation, can be NULL.
+ * @return true if the reference is valid
+ */
+bool orientation_get(struct orientation_angles * current, struct orientation_angles * reference);
+
+#endif /* _DEV_ORIENTATION_H */
@@ -6,12 +6,25 @@
 #define _DEV_IO_CONFIG_H
 
 #define SERVO_A_DDR 	DDRB
+#define SERVO_A_PORT	PORTB
+#define SERVO_A_PIN		PINB
 #define SERVO_A_IO 		PB1
+#define SERVO_A_OUTPUT	SERVO_OUTPUT_TIMER1
 
+#if defined(SERVO_B_TIMER2)
+// OC2B, driven by Timer2
+#define SERVO_B_DDR 	DDRD
+#define SERVO_B_PORT	PORTD
+#define SERVO_B_PIN		PIND
+#define SERVO_B_IO 		PD3
+#define SERVO_B_OUTPUT	SERVO_OUTPUT_TIMER2
+#else
 #define SERVO_B_DDR 	DDRC
 #define SERVO_B_PORT	PORTC
 #define SERVO_B_PIN		PINC
 #define SERVO_B_IO 		PC0
+#define SERVO_B_OUTPUT	SERVO_OUTPUT_TIMER1
+#endif
 
 #define LED_ALIVE_DDR	DDRD
 #define LED_ALIVE_PORT	PORTD
@@ -27,12 +40,25 @@
 #define BOX_SWITCH_PORT	PORTC
 #define BOX_SWITCH_PIN	PINC
 #define BOX_SWITCH_IO	PC3
+#define BOX_SWITCH_PCMSK	PCMSK1
+#define BOX_SWITCH_PCINT	PCINT11
+#define BOX_SWITCH_PCIE	PCIE1
+#define BOX_SWITCH_vect	PCINT1_vect
 
 #define ACCEL_INT_DDR	DDRD
 #define ACCEL_INT_PORT	PORTD
 #define ACCEL_INT_PIN	PIND
 #define ACCEL_INT_IO	PD2
 
+#define ACCEL_INT2_DDR	DDRD
+#define ACCEL_INT2_PORT	PORTD
+#define ACCEL_INT2_PIN	PIND
+#define ACCEL_INT2_IO	PD7
+#define ACCEL_INT2_PCMSK	PCMSK2
+#define ACCEL_INT2_PCINT	PCINT23
+#define ACCEL_INT2_PCIE	PCIE2
+#define ACCEL_INT2_vect	PCINT2_vect
+
 #define ALERT_DDR 		DDRD
 #define ALERT_PORT 		PORTD
 #define ALERT_PIN		PIND
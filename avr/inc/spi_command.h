@@ -9,6 +9,11 @@
  * This implementation requires the use of the spi.h device driver
  * and uses interrupts to manage the SPI peripheral as Slave.
  * 
+ * Blocks of data can be registered with spicmd_setBlock(). The BBB 
+ * sends the command byte of the block, the next byte shifted out is the
+ * size of the block, then one byte of the block for each byte the BBB 
+ * shifts in.
+ * 
  * Required GPIO definition in pin_config.h: 
  * 		BBB_STATUS_DDR, BBB_STATUS_PORT, BBB_STATUS_PIN, BBB_STATUS_IO
  */
@@ -17,6 +22,7 @@
 #define _DEV_SPI_CMD_H
 
 #define SPICMD_BBB_ALERT 	(0xB1)
+#define SPICMD_BBB_BOX_FAULT	(0xB2)
 
 #define SPICMD_RESP_OPENED 	(0xEA)
 #define SPICMD_RESP_CLOSED 	(0xEB)
@@ -30,7 +36,27 @@
 #define SPICMD_ERR_UNEXPECTED 	(0xFB)
 #define SPICMD_ERR_NOTINIT 		(0xFC)
 
+// Commands queued to the BBB, a power of two
+#if !defined(OUTPUT_BUFFER_SIZE)
 #define OUTPUT_BUFFER_SIZE 8
+#endif
+
+#define SPICMD_BLOCK_ISR_PROFILE	(0xC2)
+#define SPICMD_BLOCK_TRACE			(0xC3)
+#define SPICMD_BLOCK_TRACE_RESUME	(0xC4)
+#define SPICMD_BLOCK_HEALTH			(0xC5)
+
+// Trace id of the commands sent to the BBB, see trace.h
+#define TRACE_SPICMD_SEND	TRACE_USER(0x40)
+
+#define SPICMD_BLOCK_MAX	(4)
+
+struct spicmd_stats {
+	uint32_t bytes;			// Bytes shifted by the BBB
+	uint16_t desyncs;		// Unknown command bytes, the 0x00 dummies excepted
+	uint16_t queueFull;		// Commands to the BBB dropped, the output buffer was full
+	uint16_t firstByteMs;	// systick_millis() of the first byte, 0 before
+};
 
 
 /**
@@ -54,6 +80,28 @@ int spicmd_init();
  */
 int spicmd_send(uint8_t cmd);
 
+/**
+ * Registers a block the BBB can read.
+ * 
+ * The callback is called from the SPI interrupt when the command is 
+ * received, it must be short. It returns the size of the block and 
+ * points to its data, the data must stay valid until the BBB has shifted
+ * it out.
+ * 
+ * @param cmd Command byte of the block, SPICMD_BLOCK_*
+ * @param open Callback returning the size and the data of the block
+ * 
+ * @return SPICMD_OK or SPICMD_ERR_BUSY if the table is full
+ */
+int spicmd_setBlock(uint8_t cmd, uint8_t (*open)(const uint8_t ** data));
+
+/**
+ * Retrieves the counters of the link with the BBB.
+ * 
+ * @param stats Output for the counters
+ */
+void spicmd_getStats(struct spicmd_stats * stats);
+
 int spicmd_callback_unlockopen(void);
 int spicmd_callback_closelock(void);
 int spicmd_callback_checkstatus(void);
@@ -0,0 +1,124 @@
+/**
+ * Windowed vibration feature extractor and intrusion classifier for the
+ * LSM303 accelerometer sample stream.
+ *
+ * Each sample goes through an integer high-pass filter (gravity removal)
+ * and updates running features for the current window: energy, peak,
+ * zero-crossings, free-fall count and the drift of the gravity estimate
+ * (tilt). Once the window is complete the features are finalized and can
+ * be classified by a small rule set.
+ *
+ * Only 16/32-bit integer arithmetic is used. The per-sample path is a
+ * handful of 16x16->32 multiplies and shifts, so it can run on every
+ * sample at the highest data rate used by alert.c.
+ *
+ * All thresholds are in raw LSB of the 12-bit reading returned by
+ * lsm303_read() at LSM303_FS_4G (~2mg/LSB).
+ */
+
+#ifndef _DEV_VIBRATION_H
+#define _DEV_VIBRATION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Number of samples in a classification window, must be a power of 2.
+ * 
+ * Windows are sampled with the alert forensic profile (400Hz), 256
+ * samples is 640ms.
+ */
+#define VIBRATION_WINDOW_SIZE			(256)
+#define VIBRATION_WINDOW_SHIFT			(8)
+
+/**
+ * Right shift of the squared samples before accumulation so the window
+ * energy fits in 32 bits.
+ */
+#define VIBRATION_ENERGY_SHIFT			(3)
+
+/**
+ * Time constant of the gravity low-pass as a shift (2^N samples).
+ */
+#define VIBRATION_HPF_SHIFT				(6)
+
+/**
+ * Hysteresis on the high-passed signal before a sign change counts as
+ * a zero-crossing.
+ */
+#define VIBRATION_ZC_HYSTERESIS			(16)
+
+/**
+ * Total acceleration (L1 norm) under which a sample is free-fall (~0.3g).
+ */
+#define VIBRATION_FREEFALL_L1			(150)
+
+/*
+ * Classifier thresholds.
+ */
+#define VIBRATION_DROP_MIN_FREEFALL		(20)
+#define VIBRATION_DROP_MIN_PEAK			(768)
+#define VIBRATION_LIFT_MIN_TILT			(128)
+#define VIBRATION_LIFT_MAX_ZC			(12)
+#define VIBRATION_PRY_MIN_RMS			(48)
+#define VIBRATION_PRY_MAX_CREST			(4)
+
+enum vibration_class {
+	VIBRATION_CLASS_NONE =	0x0,
+	VIBRATION_CLASS_BUMP =	0x1,
+	VIBRATION_CLASS_LIFT =	0x2,
+	VIBRATION_CLASS_PRY =	0x3,
+	VIBRATION_CLASS_DROP =	0x4
+};
+
+struct vibration_features {
+	uint16_t rms;
+	uint16_t peak;
+	uint16_t tiltChange;
+	uint8_t zeroCrossings;
+	uint8_t freefallSamples;
+};
+
+/**
+ * Resets the filters and starts a new window.
+ *
+ * The first sample of the window seeds the gravity estimate.
+ */
+void vibration_reset();
+
+/**
+ * Feeds a new accelerometer sample to the current window.
+ *
+ * @param x Raw x reading
+ * @param y Raw y reading
+ * @param z Raw z reading
+ * @return true when the window is complete and features are available
+ */
+bool vibration_addSample(int16_t x, int16_t y, int16_t z);
+
+/**
+ * Finalizes and retrieves the features of the last complete window.
+ *
+ * @param features Pointer to the structure where features are written.
+ */
+void vibration_getFeatures(struct vibration_features * features);
+
+/**
+ * Classifies a window from its features.
+ *
+ * @param features Features of a complete window
+ * @return VIBRATION_CLASS_*
+ */
+enum vibration_class vibration_classify(const struct vibration_features * features);
+
+/**
+ * Checks whether a class is an intrusion pattern (Lift, Pry or Drop).
+ *
+ * @param cls VIBRATION_CLASS_*
+ * @return true if this must raise an alert
+ */
+static inline bool vibration_isIntrusion(enum vibration_class cls) {
+	return cls == VIBRATION_CLASS_LIFT || cls == VIBRATION_CLASS_PRY || cls == VIBRATION_CLASS_DROP;
+}
+
+#endif /* _DEV_VIBRATION_H */
@@ -7,6 +7,10 @@
 #define COMMAND_INPUT_ARG_MAX 16
 #endif
 
+#if !defined(COMMAND_OPT_MAX)
+#define COMMAND_OPT_MAX 12
+#endif
+
 #if !defined(COMMAND_CMD_PREFIX)
 #define COMMAND_CMD_PREFIX "CMD"
 #endif
@@ -17,9 +21,12 @@
  * New command can be added to the list and the opt if found by the parse will call the given vector.
  * hasArg, if true, will force the next opt to be an optarg. They are mandatory but not checked to exist.
  *    If an optarg is missing, the next token or null will be taken as the optarg even if it is an opt.
+ *
+ * The list is read from program memory, declare it PROGMEM. The opt names are stored in the 
+ * entries so they stay in flash too.
  */
 struct Command {
-  char * opt;
+  char opt[COMMAND_OPT_MAX];
   void (*vector)(char *);
   bool hasArg;
 };
@@ -27,10 +34,10 @@ struct Command {
 /**
  * Setup and enable the module with the given optList.
  * 
- * @param optList[] List of opt struct with command vector and arg.
+ * @param optList[] List of opt struct with command vector and arg, in program memory.
  * @param size Size of the optList. (Behaviour undefined if this is wrong)
  */
-void command_setup(struct Command optList[], size_t size);
+void command_setup(const struct Command optList[], size_t size);
 
 /**
  * Parse the given input line and executes any command found command.
@@ -0,0 +1,65 @@
+/**
+ * Integer CORDIC kernel for atan2 and vector magnitude.
+ *
+ * The kernel runs in vectoring mode with 32-bit shifts and adds only,
+ * no multiply except for the final gain correction. Angles are returned
+ * in tenths of a degree (-1800..1800).
+ *
+ * The arctangent table is stored in flash.
+ */
+
+#ifndef _DEV_CORDIC_H
+#define _DEV_CORDIC_H
+
+#include <stdint.h>
+
+#if !defined(CORDIC_ITERATIONS)
+#define CORDIC_ITERATIONS 12
+#endif
+
+#define CORDIC_ANGLE_90		(900)
+#define CORDIC_ANGLE_180	(1800)
+
+/**
+ * Rotates the vector (x, y) on the x axis and returns its angle and
+ * magnitude.
+ *
+ * @param x X component
+ * @param y Y component
+ * @param magnitude Output for the magnitude of the vector, can be NULL.
+ * @return atan2(y, x) in tenths of a degree.
+ */
+int16_t cordic_vector(int16_t x, int16_t y, uint16_t * magnitude);
+
+/**
+ * Computes atan2(y, x).
+ *
+ * @return Angle in tenths of a degree.
+ */
+static inline int16_t cordic_atan2(int16_t y, int16_t x) {
+	return cordic_vector(x, y, (uint16_t *) 0);
+}
+
+/**
+ * Computes the pitch and roll of a 3-axis accelerometer reading.
+ *
+ * 		roll = atan2(y, z)
+ * 		pitch = atan2(-x, sqrt(y^2 + z^2))
+ *
+ * @param x, y, z Raw accelerometer reading
+ * @param pitch Output pitch in tenths of a degree
+ * @param roll Output roll in tenths of a degree
+ */
+void cordic_tilt(int16_t x, int16_t y, int16_t z, int16_t * pitch, int16_t * roll);
+
+/**
+ * Integer square root, bit by bit with shifts and subtractions.
+ *
+ * Companion of the magnitude kernel for values already squared.
+ *
+ * @param value
+ * @return floor(sqrt(value))
+ */
+uint16_t cordic_sqrt(uint32_t value);
+
+#endif /* _DEV_CORDIC_H */
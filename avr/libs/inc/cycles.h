@@ -0,0 +1,43 @@
+/**
+ * CPU cycle timestamps from the free running Timer1 of servo.h.
+ * 
+ * Timer1 counts from 0 to ICR1 (a 20ms servo frame) at 
+ * F_CPU/SERVO_PRESCALER, so a timestamp has a resolution of 
+ * SERVO_PRESCALER cycles and an interval must be shorter than a frame.
+ * 
+ * servo_init() must have been called.
+ */
+
+#ifndef _DEV_CYCLES_H
+#define _DEV_CYCLES_H
+
+#include <stdint.h>
+#include <avr/io.h>
+#include "servo.h"
+
+/**
+ * Length of a frame in ms, longer intervals wrap and must be measured
+ * with systick.h.
+ */
+#define CYCLES_FRAME_MS		(SERVO_FRAME_TICKS / SERVO_TICKS_PER_US / 1000)
+
+/**
+ * Returns the current timestamp.
+ */
+static inline uint16_t cycles_now() {
+	return TCNT1;
+}
+
+/**
+ * Returns the cycles elapsed since a timestamp.
+ * 
+ * @param start Timestamp from cycles_now()
+ * @return Elapsed CPU cycles
+ */
+static inline uint32_t cycles_elapsed(uint16_t start) {
+	uint16_t end = TCNT1;
+	uint16_t ticks = (end >= start) ? (end - start) : (ICR1 + 1 - start + end);
+	return (uint32_t) ticks * SERVO_PRESCALER;
+}
+
+#endif /* _DEV_CYCLES_H */
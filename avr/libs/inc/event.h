@@ -0,0 +1,69 @@
+/**
+ * Pending event flags for a sleeping main loop.
+ * 
+ * Interrupts record what happened with event_post() and the main loop
+ * handles the pending events returned by event_wait(). When nothing is 
+ * pending the MCU sleeps in SLEEP_MODE_IDLE until the next interrupt.
+ * 
+ * IDLE is the deepest mode that keeps the clocks of Timer0 (systick.h), 
+ * Timer1 (servo.h), the SPI slave and the UART running, power-save would
+ * stop them.
+ * 
+ * Usage:
+ * 		while (1) {
+ * 			uint8_t events = event_wait();
+ * 			if (events & EVENT_TIMER) {
+ * 				timer_dispatch();
+ * 			}
+ * 			...
+ * 		}
+ */
+
+#ifndef _DEV_EVENT_H
+#define _DEV_EVENT_H
+
+#include <stdint.h>
+
+#define EVENT_TIMER		(0x01)	// Systick, the timer wheel may have expired timers
+#define EVENT_UART		(0x02)	// A line, or half a buffer, was received on the UART
+#define EVENT_WORK		(0x04)	// Deferred work is queued, see workqueue.h
+
+/**
+ * Events available to the application, n from 0 to 4.
+ */
+#define EVENT_USER(n)	(0x08 << (n))
+
+struct event_stats {
+	uint32_t sleeps;		// Number of times the MCU slept
+	uint32_t lastLatency;	// Cycles from the post that woke the MCU to the wake-up
+	uint32_t maxLatency;
+};
+
+/**
+ * Marks events as pending.
+ * 
+ * Can be called from an interrupt.
+ * 
+ * @param events EVENT_* flags
+ */
+void event_post(uint8_t events);
+
+/**
+ * Sleeps until at least one event is pending.
+ * 
+ * @return The pending EVENT_* flags, they are cleared
+ */
+uint8_t event_wait();
+
+/**
+ * Retrieves the sleep and wake-up latency statistics.
+ * 
+ * The latency is only measured when event_wait() slept, the events 
+ * found pending by a busy loop are not counted. Beyond a Timer1 frame
+ * (CYCLES_FRAME_MS) it comes from the systick at 1ms resolution.
+ * 
+ * @param stats Output for the statistics
+ */
+void event_getStats(struct event_stats * stats);
+
+#endif /* _DEV_EVENT_H */
@@ -47,6 +47,8 @@ int i2c_slave_transmit(uint8_t *data, size_t size);
  * @param addr8 Address of the Slave to read, in 8 bit format.
  * @param dataBuffer Buffer to receive the data to
  * @param size Size of the transmition
+ * 
+ * @returns -1 if the start failed or the slave didn't acknowledge
  */
 int i2c_master_receive(uint8_t addr8, uint8_t *dataBuffer, size_t size);
 
@@ -71,6 +73,8 @@ int i2c_master_transmit(uint8_t addr8, uint8_t *dataBuffer, size_t size);
  * @param reg Register to read from the device.
  * @param dataBuffer Buffer to receive the data to
  * @param size Size of the transmition
+ * 
+ * @returns -1 if the start failed or the slave didn't acknowledge
  */
 int i2c_master_read(uint8_t addr8, uint8_t reg, uint8_t *dataBuffer, size_t size);
 
@@ -82,10 +86,19 @@ int i2c_master_read(uint8_t addr8, uint8_t reg, uint8_t *dataBuffer, size_t size
  * @param reg Register to read to on the device.
  * @param dataBuffer Buffer to read the data from
  * @param size Size of the transmition
+ * 
+ * @returns -1 if the start failed or the slave didn't acknowledge
  */
 int i2c_master_write(uint8_t addr8, uint8_t reg, uint8_t *dataBuffer, size_t size);
 
 
+/**
+ * Returns the number of master transactions that failed: the start was
+ * not granted or the slave didn't acknowledge its address or a byte. 
+ * A failed transaction is aborted with a stop condition.
+ */
+uint16_t i2c_getErrors();
+
 /**
  * Attach an interrupt vector to be called when configured as slave and that
  * the device SLA+R is called.
@@ -0,0 +1,126 @@
+/**
+ * Cycle profiler of the interrupt handlers.
+ * 
+ * The hits of every vector are counted in every build, a 16 bit 
+ * increment per handler. The cycle profile is opt-in with the 
+ * ISR_PROFILE build flag (make DEFS=-DISR_PROFILE).
+ * 
+ * In a profile build every handler stamps its entry and exit with
+ * cycles.h and the hit count, min, max and cumulative cycles are kept per vector. The stamps 
+ * are taken after the prologue and before the epilogue of the handler,
+ * add ISR_PROFILE_OVERHEAD for the register saves, the vector jump and 
+ * the reti.
+ * 
+ * Usage:
+ * 		ISR(USART_RX_vect) {
+ * 			ISR_PROFILE_ENTER();
+ * 			...
+ * 			ISR_PROFILE_EXIT(ISRPROF_USART_RX);
+ * 		}
+ */
+
+#ifndef _DEV_ISR_PROF_H
+#define _DEV_ISR_PROF_H
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+#define ISRPROF_TIMER0_COMPA	(0)
+#define ISRPROF_TIMER1_CAPT		(1)
+#define ISRPROF_TIMER1_COMPA	(2)
+#define ISRPROF_SPI_STC			(3)
+#define ISRPROF_USART_RX		(4)
+#define ISRPROF_USART_UDRE		(5)
+#define ISRPROF_TWI				(6)
+#define ISRPROF_INT0			(7)
+#define ISRPROF_ACCEL_INT2		(8)
+#define ISRPROF_BOX_SWITCH		(9)
+#define ISRPROF_VECTORS			(10)
+
+// Cycles of the vector call, the jump and the reti, the register saves 
+// of the prologue and epilogue depend on the handler
+#define ISR_PROFILE_OVERHEAD	(11)
+
+struct isrprof_stats {
+	uint32_t count;			// Number of hits
+	uint32_t total;			// Cumulative CPU cycles
+	uint16_t min;			// Shortest hit in CPU cycles
+	uint16_t max;			// Longest hit in CPU cycles, saturated
+};
+
+/* Private */
+extern uint16_t isrprofHits[ISRPROF_VECTORS];
+
+/**
+ * Copies the hit count of every vector, they wrap at 16 bits.
+ * 
+ * @param hits Output for ISRPROF_VECTORS counts
+ */
+void isrprof_getHits(uint16_t * hits);
+
+#if defined(ISR_PROFILE)
+
+#include "cycles.h"
+
+/* Private */
+extern struct isrprof_stats isrprofStats[ISRPROF_VECTORS];
+
+/**
+ * Records the hit of a vector.
+ * 
+ * Inlined so a handler doesn't save the call-clobbered registers because
+ * of the profiler.
+ * 
+ * @param vector ISRPROF_*
+ * @param start Timestamp taken on entry
+ */
+static inline void isrprof_record(uint8_t vector, uint16_t start) {
+	uint32_t elapsed = cycles_elapsed(start);
+	uint16_t cycles = (elapsed > UINT16_MAX) ? UINT16_MAX : elapsed;
+	struct isrprof_stats * stats = &isrprofStats[vector];
+	
+	if (stats->count == 0 || cycles < stats->min) {
+		stats->min = cycles;
+	}
+	stats->count++;
+	stats->total += cycles;
+	if (cycles > stats->max) {
+		stats->max = cycles;
+	}
+}
+
+#define ISR_PROFILE_ENTER()			uint16_t isrProfileStart = cycles_now()
+#define ISR_PROFILE_EXIT(vector)	do { \
+		isrprofHits[(vector)]++; \
+		isrprof_record((vector), isrProfileStart); \
+	} while (0)
+
+/**
+ * Copies the statistics of every vector.
+ * 
+ * Can be called from an interrupt.
+ * 
+ * @param stats Output for ISRPROF_VECTORS statistics
+ */
+void isrprof_get(struct isrprof_stats * stats);
+
+/**
+ * Returns the name of a vector, in program memory.
+ * 
+ * @param vector ISRPROF_*
+ */
+PGM_P isrprof_getName(uint8_t vector);
+
+/**
+ * Resets the statistics of every vector.
+ */
+void isrprof_reset();
+
+#else
+
+#define ISR_PROFILE_ENTER()
+#define ISR_PROFILE_EXIT(vector)	(isrprofHits[(vector)]++)
+
+#endif /* ISR_PROFILE */
+
+#endif /* _DEV_ISR_PROF_H */
@@ -21,6 +21,48 @@ enum lsm303_full_scale {
 	LSM303_FS_16G =	0x3
 };
 
+/**
+ * Power mode of the accelerometer.
+ * 
+ * Low power (LPEN) has 8-bit output, Normal 10-bit and High resolution
+ * 12-bit. The reading is left-aligned and decoded to the same scale.
+ */
+enum lsm303_power_mode {
+	LSM303_MODE_LOW_POWER = 		0x0,
+	LSM303_MODE_NORMAL = 			0x1,
+	LSM303_MODE_HIGH_RESOLUTION = 	0x2
+};
+
+/**
+ * 6D/4D recognition mode of the orientation interrupt.
+ * 
+ * Movement triggers when the orientation changes, Position while the 
+ * device stays in a known orientation. 4D ignores the Z axis.
+ */
+enum lsm303_orientation_mode {
+	LSM303_ORIENTATION_6D_MOVEMENT = 	0x0,
+	LSM303_ORIENTATION_6D_POSITION = 	0x1,
+	LSM303_ORIENTATION_4D_MOVEMENT = 	0x2,
+	LSM303_ORIENTATION_4D_POSITION = 	0x3
+};
+
+/*
+ * CLICK_CFG_A axis enable, Single and Double click.
+ */
+#define LSM303_CLICK_XS		(0x01)
+#define LSM303_CLICK_XD		(0x02)
+#define LSM303_CLICK_YS		(0x04)
+#define LSM303_CLICK_YD		(0x08)
+#define LSM303_CLICK_ZS		(0x10)
+#define LSM303_CLICK_ZD		(0x20)
+
+/*
+ * CLICK_SRC_A and INTx_SRC_A status bits.
+ */
+#define LSM303_SRC_IA		(0x40)
+#define LSM303_CLICK_SRC_DCLICK	(0x20)
+#define LSM303_CLICK_SRC_SCLICK	(0x10)
+
 enum lsm303_status {
 	LSM303_OK = 0x0,
 	LSM303_DATA_NREADY = 0x1
@@ -50,6 +92,21 @@ struct lsm303_accel_reading {
  */
 int lsm303_init(enum lsm303_data_rate rate, enum lsm303_full_scale scale);
 
+/**
+ * Changes the data rate, reading scale and power mode of the 
+ * accelerometer.
+ * 
+ * CTRL_REG1_A to CTRL_REG4_A are written in a single I2C burst, this can
+ * be called at any time after lsm303_init() to switch profiles.
+ * 
+ * @param rate 		Accelerometer data rate
+ * @param scale		FullScale of the accelerometer
+ * @param mode		Power mode of the accelerometer
+ * 
+ * @return >= 0 on success, negative otherwise.
+ */
+int lsm303_set_mode(enum lsm303_data_rate rate, enum lsm303_full_scale scale, enum lsm303_power_mode mode);
+
 /**
  * Enables the movement interrupt for the accelerometer with the given
  * threshold and duration. See the datasheet with param.
@@ -60,6 +117,45 @@ int lsm303_init(enum lsm303_data_rate rate, enum lsm303_full_scale scale);
  */
 int lsm303_set_interrupt(uint8_t threshold, uint8_t duration);
 
+/**
+ * Enables the click engine of the accelerometer routed on INT2.
+ * 
+ * The click engine sees the data through the high-pass filter (HPCLICK),
+ * the 1 g of gravity on any axis doesn't count as a click.
+ * 
+ * @param axes LSM303_CLICK_* OR combination
+ * @param threshold See datasheet (Direct reg values)
+ * @param timeLimit Max duration of a click, in ODR periods
+ * @param latency Quiet time after a click, in ODR periods
+ * @param window Window for the second click, in ODR periods
+ */
+int lsm303_set_click(uint8_t axes, uint8_t threshold, uint8_t timeLimit, uint8_t latency, uint8_t window);
+
+/**
+ * Enables the 6D/4D orientation interrupt of the accelerometer latched 
+ * on INT2.
+ * 
+ * @param mode LSM303_ORIENTATION_*
+ * @param threshold See datasheet (Direct reg values)
+ * @param duration See datasheet (Direct reg values)
+ */
+int lsm303_set_orientation_interrupt(enum lsm303_orientation_mode mode, uint8_t threshold, uint8_t duration);
+
+/**
+ * Clear the latched orientation interrupt on INT2 and returns the raw 
+ * status.
+ * 
+ * @return the raw INT2_SRC_A from the device (LSM303_SRC_IA is set on event).
+ */
+int lsm303_clear_orientation_interrupt();
+
+/**
+ * Clear the click interrupt and returns the raw status.
+ * 
+ * @return the raw CLICK_SRC_A from the device (LSM303_CLICK_SRC_*).
+ */
+int lsm303_clear_click();
+
 /**
  * Clear the latched interrupt and returns the raw status.
  * 
@@ -76,6 +172,8 @@ int lsm303_clear_latched_interrupt();
  * 
  * @param pointer to an lsm303_accel_reading  structure where the reading
  * 			will be written by the driver.
+ * @return 1, or 0 if the I2C transaction failed and the status is 
+ * 			LSM303_DATA_NREADY
  */
 int lsm303_read(struct lsm303_accel_reading * reading);
 
@@ -0,0 +1,37 @@
+/**
+ * SRAM usage of the firmware: static data, heap and stack.
+ * 
+ * The RAM between the end of .bss and the stack is painted with 
+ * MEMSTAT_CANARY at boot, before main() and the .data/.bss 
+ * initialization. The stack high-water mark is found by scanning for the
+ * first painted byte that was overwritten.
+ * 
+ * The static RAM of every module is printed by "make ram".
+ */
+
+#ifndef _DEV_MEMSTAT_H
+#define _DEV_MEMSTAT_H
+
+#include <stdint.h>
+
+#define MEMSTAT_CANARY	(0xC5)
+
+struct memstat {
+	uint16_t data;			// Size of .data
+	uint16_t bss;			// Size of .bss
+	uint16_t heap;			// Bytes taken by malloc()
+	uint16_t stackFree;		// Between the heap and the stack pointer
+	uint16_t stackUnused;	// Free bytes never used by the stack since boot
+	uint16_t stackPeak;		// Deepest stack since boot
+};
+
+/**
+ * Computes the current RAM usage and the stack high-water mark.
+ * 
+ * Scans the free RAM, it takes about 10 cycles per free byte.
+ * 
+ * @param stat Output for the RAM usage
+ */
+void memstat_get(struct memstat * stat);
+
+#endif /* _DEV_MEMSTAT_H */
@@ -0,0 +1,87 @@
+/**
+ * Non-blocking motion engine for the servo.h channels.
+ * 
+ * Each channel moves to its target with a trapezoidal velocity profile:
+ * it accelerates up to the maximum velocity and decelerates to stop on
+ * the target. The profile is stepped every MOTION_TICK_MS from a 
+ * timerwheel.h timer, so timer_dispatch() must run in the main loop.
+ * 
+ * Angles of the profile are in degrees, the position is written to the
+ * servo with its tenth of a degree resolution.
+ * 
+ * The motion starts from the last position written to the servo, the
+ * channel must have been initialized with servo_channel_init_angle().
+ * 
+ * Completion is reported by motion_isDone() or by the optional callback,
+ * called from timer_dispatch().
+ */
+
+#ifndef _DEV_MOTION_H
+#define _DEV_MOTION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if !defined(MOTION_CHANNELS)
+#define MOTION_CHANNELS		(2)
+#endif
+
+/**
+ * Period of the profile steps, a servo frame (50Hz).
+ */
+#define MOTION_TICK_MS		(20)
+
+/**
+ * Starts a move of a channel to a target angle.
+ * 
+ * A move already in progress on the channel continues from its current
+ * position and velocity to the new target.
+ * 
+ * @param channel Servo channel (SERVO_CHANNEL*)
+ * @param angle Target angle (between 0 and 180)
+ * @param velocity Maximum velocity in degrees/s, 0 to jump directly
+ * @param acceleration Acceleration in degrees/s^2, 0 for none
+ * @param done Callback on completion with the channel, can be NULL
+ * @return 0 on success, negative on error
+ */
+int motion_move(int channel, int angle, uint16_t velocity, uint16_t acceleration, void (*done)(int));
+
+/**
+ * Sets a one-shot callback for when the channel profile crosses an angle.
+ * 
+ * The callback is called from timer_dispatch() on the profile step that
+ * reaches or passes the angle, so a dependent move can start before the
+ * channel completes its own move. It is cleared once called and by
+ * motion_stop().
+ * 
+ * @param channel Servo channel (SERVO_CHANNEL*)
+ * @param angle Angle to watch (between 0 and 180)
+ * @param trigger Callback with the channel, NULL to clear
+ * @return 0 on success, negative on error
+ */
+int motion_setTrigger(int channel, int angle, void (*trigger)(int));
+
+/**
+ * Stops a channel at its current position.
+ * 
+ * The completion callback is not called.
+ * 
+ * @return 0 on success, negative on error
+ */
+int motion_stop(int channel);
+
+/**
+ * Checks whether the channel reached its target.
+ * 
+ * @return true if no move is in progress on the channel
+ */
+bool motion_isDone(int channel);
+
+/**
+ * Returns the current angle of the channel profile.
+ * 
+ * @return Angle in degrees, negative on error
+ */
+int motion_position(int channel);
+
+#endif /* _DEV_MOTION_H */
@@ -0,0 +1,73 @@
+/**
+ * Cooperative priority scheduler for the main loop.
+ * 
+ * The application declares a static table of tasks, each one runs on 
+ * pending events (event.h), on a period, or both. On every loop 
+ * iteration the ready tasks are run to completion in priority order, 
+ * 0 being the highest priority.
+ * 
+ * Every task keeps its invocation count, cumulative cycles and worst 
+ * case run time, measured with cycles.h. A run longer than a servo frame
+ * falls back to the millisecond systick for the measure.
+ * 
+ * Usage:
+ * 		static const char timerName[] PROGMEM = "timer";
+ * 		static const char ledName[] PROGMEM = "led";
+ * 		static struct task tasks[] = {
+ * 			{timerName, timer_dispatch, 0, EVENT_TIMER, 0},
+ * 			{ledName, blink, 5, 0, 500},
+ * 		};
+ * 		scheduler_init(tasks, LENGTH_OF_ARRAY(tasks));
+ * 		while (1) {
+ * 			scheduler_run(event_wait());
+ * 		}
+ * 
+ * Periodic tasks are checked on every wake-up, the systick wakes the 
+ * loop every millisecond.
+ */
+
+#ifndef _DEV_SCHEDULER_H
+#define _DEV_SCHEDULER_H
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+struct task {
+	PGM_P name;				// In program memory, printed with %S
+	void (*run)(void);
+	uint8_t priority;		// 0 is the highest
+	uint8_t events;			// EVENT_* flags that make the task ready, 0 for none
+	uint16_t period;		// Milliseconds between runs, 0 for none
+	
+	/* Statistics */
+	uint32_t count;			// Number of runs
+	uint32_t cycles;		// Cumulative CPU cycles
+	uint32_t worst;			// Longest run in CPU cycles
+	
+	/* Private */
+	uint32_t lastRun;
+};
+
+/**
+ * Sets the task table and sorts it by priority.
+ * 
+ * Periodic tasks first run one period after the call.
+ * 
+ * @param table Task table, must stay valid
+ * @param count Number of tasks in the table
+ */
+void scheduler_init(struct task * table, uint8_t count);
+
+/**
+ * Runs the ready tasks in priority order.
+ * 
+ * @param events The pending EVENT_* flags, usually from event_wait()
+ */
+void scheduler_run(uint8_t events);
+
+/**
+ * Resets the statistics of every task.
+ */
+void scheduler_resetStats();
+
+#endif /* _DEV_SCHEDULER_H */
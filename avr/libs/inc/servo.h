@@ -1,29 +1,97 @@
 /**
  * Library to control servo motors using the atmega328P. In order to use, the library
  * must be initialized as follows:
- * 1) Call servo_init() to setup timers for the servo motors
+ * 1) Call servo_init() with the descriptor table of the servos to setup the timers
  * 2) Initialize the desired channel using servo_channel_init(channel)
+ * 
+ * A channel is the index of its servo in the descriptor table, up to
+ * SERVO_MAX_CHANNELS. The table is owned by the application:
+ * 
+ * 		static const struct servo_descriptor servos[] = {
+ * 			{&PORTB, &DDRB, PB1, SERVO_OUTPUT_TIMER1, 0, 0},
+ * 			{&PORTC, &DDRC, PC0, SERVO_OUTPUT_TIMER1, 500, 2500},
+ * 		};
+ * 		servo_init(servos, 2);
+ * 
+ * Angles are in tenths of a degree. The angle is mapped linearly on the
+ * pulse width between the minimum and maximum pulses of the channel, see
+ * servo_calibrate(). Only integer arithmetic is used.
+ * 
+ * SERVO_OUTPUT_TIMER1 channels are multiplexed on Timer1: all pulses
+ * start together at the beginning of the 20ms frame, then the channels
+ * are cleared in pulse width order by compare matches programmed back to
+ * back, N+1 interrupts per frame for N channels. 
+ * 
+ * A SERVO_OUTPUT_TIMER2 channel is the OC2B output (PD3) of Timer2 with no
+ * interrupt: the frame is 61Hz and the resolution 64us, which is enough
+ * for a servo that moves between a few fixed positions (the box lock).
+ * 
+ * A channel with a hold time is detached once it hasn't been written for
+ * that time: its pulses stop and the servo no longer draws holding 
+ * current. The next servo_write() re-attaches it. The hold timers run on
+ * timerwheel.h, so timer_dispatch() must run in the main loop.
  */
 #ifndef _DEV_SERVO_H
 #define _DEV_SERVO_H
 
 #include <avr/io.h>
+#include <stdint.h>
+#include <stdbool.h>
 
+// First two channels of the descriptor table
 #define SERVO_CHANNELA 0
 #define SERVO_CHANNELB 1
 
-#define NEUTRAL 375
-#define BASE_VALUE 150
+#if !defined(SERVO_MAX_CHANNELS)
+#define SERVO_MAX_CHANNELS 8
+#endif
+
+// Angles in tenths of a degree
 #define MIN_ANGLE 0
-#define MAX_ANGLE 180
-#define UNITS_PER_DEGREE 2.5
+#define MAX_ANGLE 1800
+#define NEUTRAL_ANGLE 900
+#define SERVO_DEGREES(degrees) ((degrees) * 10)
+
+// Default pulse widths at MIN_ANGLE and MAX_ANGLE in us
+#if !defined(SERVO_MIN_PULSE_US)
+#define SERVO_MIN_PULSE_US 600
+#endif
+#if !defined(SERVO_MAX_PULSE_US)
+#define SERVO_MAX_PULSE_US 2400
+#endif
+
+// Timer1 runs at F_CPU/8, 2 ticks per us at 16MHz
+#define SERVO_PRESCALER 8
+#define SERVO_TICKS_PER_US (F_CPU / SERVO_PRESCALER / 1000000UL)
+#define SERVO_FRAME_TICKS (20000 * SERVO_TICKS_PER_US)
+
+// Duration of a Timer2 tick in us (prescaler 1024)
+#define SERVO_TIMER2_TICK_US 64
+
+// Output of a servo channel
+#define SERVO_OUTPUT_TIMER1 0 // GPIO multiplexed on Timer1
+#define SERVO_OUTPUT_TIMER2 1 // OC2B of Timer2, the pin of the descriptor must be PD3
+
+/**
+ * Description of a servo channel.
+ */
+struct servo_descriptor {
+    volatile uint8_t * port;
+    volatile uint8_t * ddr;
+    uint8_t pin;
+    uint8_t output;     // SERVO_OUTPUT_*
+    uint16_t minPulse;  // Pulse width at MIN_ANGLE in us, 0 for SERVO_MIN_PULSE_US
+    uint16_t maxPulse;  // Pulse width at MAX_ANGLE in us, 0 for SERVO_MAX_PULSE_US
+};
 
 /**
  * Initializes the Servo library by setting up Timer1
  * 
+ * @param table Descriptors of the channels, must stay valid
+ * @param count Number of channels in the table, up to SERVO_MAX_CHANNELS
  * @return 0 on success, negative on error
  */
-int servo_init();
+int servo_init(const struct servo_descriptor * table, uint8_t count);
 
 /**
  * Initializes the desired channel for a servo motor at neutral
@@ -34,27 +102,60 @@ int servo_channel_init(int channel);
 
 /**
  * Initializes the desired channel for a servo motor with the indicated
- * starting angle
+ * starting angle in tenths of a degree
  * 
  * @return 0 on success, negative on error
  */
 int servo_channel_init_angle(int channel, int angle);
 
 /**
- * Moves the requested servo motor to the desired angle. Must be a value between 0 and 180
+ * Sets the pulse widths of a channel at MIN_ANGLE and MAX_ANGLE.
+ * 
+ * Channels default to SERVO_MIN_PULSE_US and SERVO_MAX_PULSE_US. The
+ * current angle is applied again with the new calibration.
+ * 
+ * @param channel The servo to calibrate
+ * @param minPulse Pulse width at MIN_ANGLE in us
+ * @param maxPulse Pulse width at MAX_ANGLE in us, larger than minPulse
+ * @return 0 on success, negative on error
+ */
+int servo_calibrate(int channel, uint16_t minPulse, uint16_t maxPulse);
+
+/**
+ * Moves the requested servo motor to the desired angle. Must be a value between 0 and 1800
  * 
  * @param channel The Servo to be written to
- * @param angle The angle to move to (between 0 and 180)
+ * @param angle The angle to move to in tenths of a degree (between 0 and 1800)
  * @return 0 on success, negative on error
  */
 int servo_write(int channel, int angle);
 
+/**
+ * Sets the time the pulses are kept after the last write of a channel,
+ * for the move to complete and the servo to settle.
+ * 
+ * @param channel The servo
+ * @param holdTime Time in ms, 0 to never detach (default)
+ * @return 0 on success, negative on error
+ */
+int servo_setHoldTime(int channel, uint16_t holdTime);
+
+/**
+ * Checks whether the pulses of a channel are generated
+ * 
+ * @param channel The servo
+ * @return true if attached, false if detached after its hold time or not initialized
+ */
+bool servo_isAttached(int channel);
+
 /**
  * Returns the current angle of the servo on the desired channel
  * 
+ * This is the last commanded angle, also while the channel is detached.
+ * 
  * @param channel The servo to read
- * @return the angle of the motor, between 0 and 180
+ * @return the angle of the motor in tenths of a degree, between 0 and 1800, negative on error
  */
-long servo_read(int channel);
+int servo_read(int channel);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,52 @@
+/**
+ * System tick for the atmega328p on Timer0.
+ * 
+ * Timer0 is used in CTC mode to generate a 1ms interrupt that increments
+ * the millisecond counter. This is the shared timebase of the firmware,
+ * see timerwheel.h to schedule callbacks on it.
+ * 
+ * Timer0 must not be used by any other module.
+ */
+
+#ifndef _DEV_SYSTICK_H
+#define _DEV_SYSTICK_H
+
+#include <stdint.h>
+
+#define SYSTICK_PRESCALER	(64)
+#define SYSTICK_HZ			(1000)
+
+/**
+ * Starts Timer0 for the 1ms system tick.
+ * 
+ * Global interrupts must be enabled for the tick to run.
+ * 
+ * @return 0 on success
+ */
+int systick_init();
+
+/**
+ * Returns the number of milliseconds since systick_init().
+ * 
+ * Wraps after ~49 days, compare with systick_elapsed().
+ */
+uint32_t systick_millis();
+
+/**
+ * Returns a 16-bit timestamp in 1/16 ms from the millisecond counter and
+ * Timer0, it wraps every 4.096 s.
+ * 
+ * Must be called with interrupts disabled.
+ */
+uint16_t systick_stamp();
+
+/**
+ * Milliseconds elapsed since a previous systick_millis() value.
+ * 
+ * @param since Previous systick_millis() value
+ */
+static inline uint32_t systick_elapsed(uint32_t since) {
+	return systick_millis() - since;
+}
+
+#endif /* _DEV_SYSTICK_H */
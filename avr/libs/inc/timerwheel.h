@@ -0,0 +1,79 @@
+/**
+ * Software timers on the systick.h millisecond timebase.
+ * 
+ * Timers are kept in a hashed wheel of TIMER_WHEEL_SLOTS lists indexed by
+ * their expiry tick, so a dispatch only scans the timers of the elapsed
+ * ticks. One-shot and periodic callbacks are called from 
+ * timer_dispatch() in the main loop, never from an interrupt.
+ * 
+ * The timer structures are owned by the caller (usually static in the 
+ * module) and must stay valid while the timer is active.
+ * 
+ * Usage:
+ * 		static struct timer t;
+ * 		timer_init(&t, callback, NULL);
+ * 		timer_start(&t, 100, 0);  // One-shot in 100ms
+ * 		timer_start(&t, 10, 10);  // Every 10ms
+ * 
+ * None of these functions can be called from an interrupt.
+ */
+
+#ifndef _DEV_TIMER_WHEEL_H
+#define _DEV_TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if !defined(TIMER_WHEEL_SLOTS)
+#define TIMER_WHEEL_SLOTS 16
+#endif
+
+struct timer {
+	/* Private */
+	struct timer * next;
+	uint32_t expires;
+	uint16_t period;
+	uint8_t state;
+	uint8_t slot;
+	void (*callback)(void *);
+	void * arg;
+};
+
+/**
+ * Initializes a timer with its callback.
+ * 
+ * @param timer Timer to initialize
+ * @param callback Function called from timer_dispatch() on expiry
+ * @param arg Argument given to the callback
+ */
+void timer_init(struct timer * timer, void (*callback)(void *), void * arg);
+
+/**
+ * Starts or restarts a timer.
+ * 
+ * @param timer Initialized timer
+ * @param delay Milliseconds before the first expiry
+ * @param period Milliseconds between expiries, 0 for one-shot
+ */
+void timer_start(struct timer * timer, uint16_t delay, uint16_t period);
+
+/**
+ * Stops a timer, it is safe to stop an inactive timer.
+ */
+void timer_stop(struct timer * timer);
+
+/**
+ * Checks whether a timer is waiting to expire.
+ */
+bool timer_isActive(struct timer * timer);
+
+/**
+ * Calls the callbacks of the expired timers.
+ * 
+ * Must be called from the main loop at least every TIMER_WHEEL_SLOTS ms 
+ * to keep the expiries precise. Late calls still fire every expired 
+ * timer.
+ */
+void timer_dispatch();
+
+#endif /* _DEV_TIMER_WHEEL_H */
@@ -0,0 +1,122 @@
+/**
+ * Binary trace of timestamped events in RAM.
+ * 
+ * Every record is 4 bytes: a 16-bit timestamp in 1/16 ms from 
+ * systick_stamp(), an event id and an 8-bit argument. The records are
+ * kept in a ring of TRACE_SIZE, the oldest are overwritten.
+ * 
+ * trace() can be called from interrupts and tasks, it takes a few dozen
+ * cycles. The ids are grouped by their 3 high bits, a group can be 
+ * masked at run time with trace_setMask().
+ * 
+ * The trace freezes when trace_freeze() is called, or after a trigger 
+ * id was recorded, see trace_setTrigger(). The whole trace is a single
+ * struct trace_dump so it can be shifted out as is, see 
+ * bbb/avr_diag.py for the decoder.
+ * 
+ * The timestamps wrap every 4.096 s, trace_tick() must be called every
+ * second to keep the gaps between records shorter.
+ */
+
+#ifndef _DEV_TRACE_H
+#define _DEV_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if !defined(TRACE_SIZE)
+#define TRACE_SIZE 32
+#endif
+
+#define TRACE_GROUP(id)		((id) >> 5)
+
+#define TRACE_GROUP_SYSTEM	(0)
+#define TRACE_GROUP_SPI		(1)
+#define TRACE_GROUP_I2C		(2)
+
+// The sampling timers read the accelerometer up to 500 times a second
+#define TRACE_MASK_DEFAULT	(0xFF & ~(1 << TRACE_GROUP_I2C))
+
+#define TRACE_MARK			(0x01)	// Debug mark, arg is free
+#define TRACE_TICK			(0x02)	// Keeps the timestamps unwrappable
+#define TRACE_SPI_BYTE		(0x20)	// Byte received by the SPI, arg is the byte
+#define TRACE_I2C_READ		(0x40)	// Register read, arg is the register
+#define TRACE_I2C_WRITE		(0x41)	// Register write, arg is the register
+#define TRACE_I2C_ERROR		(0x42)	// Transaction failed, arg is TW_STATUS
+
+/**
+ * Ids available to the application, n from 0 to 0x7F. Use n from 0x20 
+ * up for another group.
+ */
+#define TRACE_USER(n)		(0x80 + (n))
+
+#define TRACE_FLAG_FROZEN	(0x01)
+#define TRACE_FLAG_WRAPPED	(0x02)	// Every record is valid
+
+struct trace_record {
+	uint16_t time;		// 1/16 ms
+	uint8_t id;
+	uint8_t arg;
+};
+
+struct trace_dump {
+	uint32_t anchorMillis;	// systick_millis() when frozen
+	uint16_t anchorTime;	// systick_stamp() when frozen
+	uint8_t head;			// Index of the next record, the oldest if wrapped
+	uint8_t flags;			// TRACE_FLAG_*
+	struct trace_record records[TRACE_SIZE];
+};
+
+/**
+ * Records an event.
+ * 
+ * Can be called from an interrupt.
+ * 
+ * @param id TRACE_* id
+ * @param arg Argument of the event
+ */
+void trace(uint8_t id, uint8_t arg);
+
+/**
+ * Records a TRACE_TICK if nothing was recorded since the previous call.
+ * 
+ * Must be called every second.
+ */
+void trace_tick();
+
+/**
+ * Stops recording and stamps the anchor of the timestamps.
+ * 
+ * Can be called from an interrupt.
+ */
+void trace_freeze();
+
+/**
+ * Empties the trace and starts recording again.
+ */
+void trace_resume();
+
+/**
+ * Freezes the trace after an id is recorded.
+ * 
+ * @param id TRACE_* id, 0 for none
+ * @param after Number of records kept after the trigger
+ */
+void trace_setTrigger(uint8_t id, uint8_t after);
+
+/**
+ * Selects the recorded groups.
+ * 
+ * @param mask Bit TRACE_GROUP(id) set to record the id
+ */
+void trace_setMask(uint8_t mask);
+
+/**
+ * Freezes the trace and returns it.
+ * 
+ * Can be called from an interrupt, the trace stays frozen until 
+ * trace_resume().
+ */
+const struct trace_dump * trace_get();
+
+#endif /* _DEV_TRACE_H */
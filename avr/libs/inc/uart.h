@@ -3,7 +3,7 @@
  * The implementation is non-blocking and uses interrupts.
  * 
  * Usage:
- * 	Write - fprintf(&uartStream, ....)
+ * 	Write - fprintf_P(&uartStream, PSTR("..."), ...)
  * 	Read - Check for available() bytes and then read each bytes.
  * 
  * The driver will fill an internal buffer when new bytes are available.
@@ -11,6 +11,9 @@
  * 			UART_TX_BUFFER_SIZE
  * 			UART_RX_BUFFER_SIZE
  * 		Buffers defaults to 64 bytes.
+ * 
+ * EVENT_UART (event.h) is posted when a newline is received or the 
+ * receive buffer is half full.
  */
  
 #ifndef _DEV_UART_H
@@ -59,7 +62,8 @@ int uart_open(uint32_t baudRate, uint8_t direction, uint8_t parity, uint8_t fram
 /**
  * Write a character to the UART.
  * 
- * This module should be used with the uartStream FILE object and fprintf.
+ * This module should be used with the uartStream FILE object and fprintf_P,
+ * the format strings are kept in flash with PSTR().
  */
 int uart_write(char c, FILE *stream);
 
@@ -77,4 +81,10 @@ int uart_available();
  */
 int uart_read();
 
+/**
+ * Returns the number of received bytes dropped because the Rx buffer 
+ * was full.
+ */
+uint16_t uart_getOverruns();
+
 #endif /* _DEV_UART_H */
@@ -0,0 +1,48 @@
+/**
+ * Deferred work queue for interrupt handlers.
+ * 
+ * An interrupt that needs slow or blocking follow-up work (an I2C 
+ * transaction, a print) posts a function and its argument, the function
+ * is called later from the main loop with interrupts enabled. Posting
+ * also posts EVENT_WORK (event.h) so workqueue_run() is called on the 
+ * next loop iteration.
+ * 
+ * The queue is a fixed ring of WORK_QUEUE_SIZE items. Items are run in
+ * the order they were posted.
+ */
+
+#ifndef _DEV_WORK_QUEUE_H
+#define _DEV_WORK_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if !defined(WORK_QUEUE_SIZE)
+#define WORK_QUEUE_SIZE 8
+#endif
+
+/**
+ * Queues a function to be called from workqueue_run().
+ * 
+ * Can be called from an interrupt.
+ * 
+ * @param work Function to call
+ * @param arg Argument given to the function
+ * @return true if queued, false if the queue is full
+ */
+bool workqueue_post(void (*work)(void *), void * arg);
+
+/**
+ * Calls the queued functions until the queue is empty.
+ * 
+ * Must be called from the main loop on EVENT_WORK, never from an 
+ * interrupt.
+ */
+void workqueue_run();
+
+/**
+ * Returns the number of items dropped because the queue was full.
+ */
+uint16_t workqueue_getDropped();
+
+#endif /* _DEV_WORK_QUEUE_H */
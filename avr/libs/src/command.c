@@ -1,7 +1,8 @@
 #include <string.h>
+#include <avr/pgmspace.h>
 #include "command.h"
 
-static struct Command * optList;
+static const struct Command * optList;
 static size_t optSize;
 
 /**
@@ -34,12 +35,14 @@ int command_execute(char * input, void (*echoVector)(char *, char *)) {
 
 	int optind;
 	for (optind = 1; optind < argc; optind++) {
+		struct Command opt;
 		char * optArg = NULL;
 		int optDefInd = -1;
 		if (*argv[optind] == '-') {
 			for (int i = 0; i < optSize; i++) {
-				if (strcmp(optList[i].opt, argv[optind] + 1) == 0) {
-					if (optList[i].hasArg && i < argc + 1) {
+				if (strcmp_P(argv[optind] + 1, optList[i].opt) == 0) {
+					memcpy_P(&opt, &optList[i], sizeof(opt));
+					if (opt.hasArg && optind + 1 < argc) {
 						optArg = argv[optind+1];
 					}
 					optDefInd = i;
@@ -49,10 +52,12 @@ int command_execute(char * input, void (*echoVector)(char *, char *)) {
 		  
 			if (optDefInd >= 0) {
 				if (echoVector != NULL) {
-					echoVector(optList[optDefInd].opt, optArg);
+					echoVector(opt.opt, optArg);
+				}
+				opt.vector(optArg);
+				if (opt.hasArg) {
+					optind++; // skip the next token it was an arg
 				}
-				optList[optDefInd].vector(optArg);
-				optind++; // skip the next token it was an arg
 			}
 		}
 	}
@@ -62,7 +67,7 @@ int command_execute(char * input, void (*echoVector)(char *, char *)) {
 /*
  * @see command.h
  */
-void command_setup(struct Command opts[], size_t size) {
+void command_setup(const struct Command opts[], size_t size) {
 	optList = opts;
 	optSize = size;
 }
@@ -0,0 +1,114 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <avr/pgmspace.h>
+#include "cordic.h"
+
+// Extra fractional bits of the angle accumulator
+#define ANGLE_FRAC		(4)
+// Extra fractional bits of the rotated vector
+#define VECTOR_FRAC		(8)
+
+// 1/K = prod(1/sqrt(1 + 2^-2i)) in Q15
+#define CORDIC_GAIN_Q15	(19898)
+
+#define ANGLE_TABLE_SIZE (14)
+
+#if CORDIC_ITERATIONS > ANGLE_TABLE_SIZE
+#error CORDIC_ITERATIONS is larger than the arctangent table
+#endif
+
+/**
+ * atan(2^-i) in tenths of a degree, with ANGLE_FRAC fractional bits.
+ */
+static const int16_t atanTable[ANGLE_TABLE_SIZE] PROGMEM = {
+	7200, 4250, 2246, 1140, 572, 286, 143, 72, 36, 18, 9, 4, 2, 1
+};
+
+/**
+ * CORDIC in vectoring mode on 32-bit components.
+ *
+ * The vector is first brought to the right half-plane, then rotated
+ * until y is 0 while the rotations are accumulated.
+ *
+ * @param x X component, at most 17 bits
+ * @param y Y component, at most 17 bits
+ * @param magnitude Output for the magnitude, can be NULL.
+ * @return The angle in tenths of a degree.
+ */
+static int16_t vectorize(int32_t x, int32_t y, uint16_t * magnitude) {
+	int32_t angle = 0;
+
+	if (x < 0) {
+		angle = (y >= 0) ? ((int32_t) CORDIC_ANGLE_180 << ANGLE_FRAC) : -((int32_t) CORDIC_ANGLE_180 << ANGLE_FRAC);
+		x = -x;
+		y = -y;
+	}
+
+	// Multiplied, y can be negative
+	x *= 1 << VECTOR_FRAC;
+	y *= 1 << VECTOR_FRAC;
+
+	for (uint8_t i = 0; i < CORDIC_ITERATIONS; i++) {
+		int32_t xShift = x >> i;
+		int32_t yShift = y >> i;
+		int16_t step = pgm_read_word(&atanTable[i]);
+
+		if (y > 0) {
+			x += yShift;
+			y -= xShift;
+			angle += step;
+		} else {
+			x -= yShift;
+			y += xShift;
+			angle -= step;
+		}
+	}
+
+	if (magnitude != NULL) {
+		*magnitude = ((uint32_t) (x >> VECTOR_FRAC) * CORDIC_GAIN_Q15) >> 15;
+	}
+
+	// Round to the nearest tenth of a degree
+	return (angle + (1 << (ANGLE_FRAC - 1))) >> ANGLE_FRAC;
+}
+
+/*
+ * @see cordic.h
+ */
+int16_t cordic_vector(int16_t x, int16_t y, uint16_t * magnitude) {
+	return vectorize(x, y, magnitude);
+}
+
+/*
+ * @see cordic.h
+ */
+void cordic_tilt(int16_t x, int16_t y, int16_t z, int16_t * pitch, int16_t * roll) {
+	uint16_t yzMagnitude;
+
+	*roll = vectorize(z, y, &yzMagnitude);
+	*pitch = vectorize(yzMagnitude, -(int32_t) x, NULL);
+}
+
+/*
+ * @see cordic.h
+ */
+uint16_t cordic_sqrt(uint32_t value) {
+	uint32_t result = 0;
+	uint32_t bit = (uint32_t) 1 << 30;
+
+	while (bit > value) {
+		bit >>= 2;
+	}
+
+	while (bit != 0) {
+		if (value >= result + bit) {
+			value -= result + bit;
+			result = (result >> 1) + bit;
+		} else {
+			result >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	return result;
+}
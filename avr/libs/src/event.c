@@ -0,0 +1,88 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+#include "event.h"
+#include "cycles.h"
+#include "systick.h"
+
+static volatile uint8_t pending = 0;
+static volatile uint16_t postTime;
+static volatile uint16_t postMillis;
+
+static struct event_stats eventStats;
+
+/*
+ * @see event.h
+ */
+void event_post(uint8_t events) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		// The latency is measured from the first event
+		if (pending == 0) {
+			postTime = cycles_now();
+			postMillis = systick_millis();
+		}
+		pending |= events;
+	}
+}
+
+/**
+ * Cycles from the first post to now.
+ * 
+ * The Timer1 stamp wraps after a frame, a longer interval is taken from
+ * the systick instead.
+ */
+static uint32_t postLatency() {
+	uint16_t millis = (uint16_t) systick_millis() - postMillis;
+	
+	if (millis >= CYCLES_FRAME_MS) {
+		return (uint32_t) millis * (F_CPU / 1000);
+	}
+	return cycles_elapsed(postTime);
+}
+
+/*
+ * @see event.h
+ */
+uint8_t event_wait() {
+	uint8_t events;
+	bool slept = false;
+	
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	
+	cli();
+	while (pending == 0) {
+		// The instruction following sei is always executed, an interrupt 
+		// can't be missed between the check and the sleep
+		sleep_enable();
+		sei();
+		sleep_cpu();
+		sleep_disable();
+		cli();
+		eventStats.sleeps++;
+		slept = true;
+	}
+	if (slept) {
+		// The handler of the wake-up interrupt has posted
+		eventStats.lastLatency = postLatency();
+		if (eventStats.lastLatency > eventStats.maxLatency) {
+			eventStats.maxLatency = eventStats.lastLatency;
+		}
+	}
+	events = pending;
+	pending = 0;
+	sei();
+	
+	return events;
+}
+
+/*
+ * @see event.h
+ */
+void event_getStats(struct event_stats * stats) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		*stats = eventStats;
+	}
+}
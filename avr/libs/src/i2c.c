@@ -6,6 +6,8 @@
 #include <util/delay_basic.h>
 #include "i2c.h"
 #include "uart.h"
+#include "isrprof.h"
+#include "trace.h"
 
 static uint8_t txBuffer[I2C_TX_BUFFER_SIZE];
 
@@ -13,6 +15,7 @@ static volatile size_t txBufferTail = 0;
 static volatile size_t txBufferHead = 0;
 
 static volatile uint8_t status;
+static uint16_t errors = 0;
 
 static void (*slarVector)(void);
 
@@ -71,6 +74,34 @@ static inline void i2c_sendNoAck(uint8_t data) {
 	i2c_waitForComplete();
 }
 
+/**
+ * Records a failed transaction, the status of the TWI is kept and traced.
+ * 
+ * @return -1
+ */
+static int i2c_error(void) {
+	status = TW_STATUS;
+	errors++;
+	trace(TRACE_I2C_ERROR, status);
+	return -1;
+}
+
+/**
+ * Checks the status after a byte sent by the master, the transaction is
+ * aborted with a stop condition if the slave didn't acknowledge.
+ * 
+ * @param expected TW_MT_SLA_ACK, TW_MT_DATA_ACK or TW_MR_SLA_ACK
+ * @return 0 or -1 on error
+ */
+static int i2c_checkAck(uint8_t expected) {
+	if (TW_STATUS != expected) {
+		i2c_error();
+		i2c_stop();
+		return -1;
+	}
+	return 0;
+}
+
 int i2c_master_init(uint32_t frequency) {
 	// No prescaler
 	TWSR &= ~(_BV(TWPS1) | _BV(TWPS0));
@@ -93,10 +124,12 @@ int i2c_master_receive(uint8_t addr8, uint8_t *dataBuffer, size_t size) {
 	i2c_waitForComplete();
 	
 	if(TW_STATUS != TW_START && TW_STATUS != TW_REP_START) {
-		status = TW_STATUS;
-		return -1; 
+		return i2c_error();
 	}
 	i2c_sendNoAck(addr8 | _BV(0)); // SLA+R
+	if (i2c_checkAck(TW_MR_SLA_ACK) != 0) {
+		return -1;
+	}
 	for (int i = 0; i < size; i++) {
 		dataBuffer[i] = (i < size-1) ? i2c_readAck() : i2c_readNoAck();
 	}
@@ -116,14 +149,20 @@ int i2c_master_receive(uint8_t addr8, uint8_t *dataBuffer, size_t size) {
  * @param size Size of the transmition
  */
 int i2c_master_read(uint8_t addr8, uint8_t reg, uint8_t *dataBuffer, size_t size) {
+	trace(TRACE_I2C_READ, reg);
 	i2c_start();
 	i2c_waitForComplete();
-		if(TW_STATUS != TW_START) {
-		status = TW_STATUS;
-		return -1; 
+	if(TW_STATUS != TW_START) {
+		return i2c_error();
 	}
 	i2c_sendNoAck(addr8 & ~_BV(0)); // SLA+W
+	if (i2c_checkAck(TW_MT_SLA_ACK) != 0) {
+		return -1;
+	}
 	i2c_sendNoAck(reg);
+	if (i2c_checkAck(TW_MT_DATA_ACK) != 0) {
+		return -1;
+	}
 	// Now receive from the register, will issue a repeated start
 	return i2c_master_receive(addr8, dataBuffer, size); 
 }
@@ -138,19 +177,28 @@ int i2c_master_read(uint8_t addr8, uint8_t reg, uint8_t *dataBuffer, size_t size
  * @param size Size of the transmition
  */
 int i2c_master_write(uint8_t addr8, uint8_t reg, uint8_t *dataBuffer, size_t size) {
+	trace(TRACE_I2C_WRITE, reg);
 	i2c_start();
 	i2c_waitForComplete();
 	if(TW_STATUS != TW_START) {
-		status = TW_STATUS;
-		return -1; 
+		return i2c_error();
 	}
 	_delay_loop_1(255);
 	i2c_sendNoAck(addr8 & ~_BV(0)); // SLA+W
+	if (i2c_checkAck(TW_MT_SLA_ACK) != 0) {
+		return -1;
+	}
 	_delay_loop_1(255);
 	i2c_sendNoAck(reg);
+	if (i2c_checkAck(TW_MT_DATA_ACK) != 0) {
+		return -1;
+	}
 	_delay_loop_1(255);
 	for (int i = 0; i < size; i++) {
 		i2c_sendNoAck(dataBuffer[i]);
+		if (i2c_checkAck(TW_MT_DATA_ACK) != 0) {
+			return -1;
+		}
 		_delay_loop_1(255);
 	}
 
@@ -160,6 +208,13 @@ int i2c_master_write(uint8_t addr8, uint8_t reg, uint8_t *dataBuffer, size_t siz
 	return 0;
 }
 
+/*
+ * @see i2c.h
+ */
+uint16_t i2c_getErrors() {
+	return errors;
+}
+
 int i2c_slave_transmit(uint8_t *data, size_t size) {
 	int remaining = (txBufferTail - txBufferHead + I2C_TX_BUFFER_SIZE - 1) % I2C_TX_BUFFER_SIZE;
 	
@@ -186,6 +241,7 @@ int i2c_attachIrq_slave_read_recv(void (*vector)(void)) {
  * interrupts.
  */
 ISR(TWI_vect) {
+	ISR_PROFILE_ENTER();
 	// Handle the I2C state machine for Slave Transmitter
 	switch(TW_STATUS) {
 		// SLA+R Received
@@ -209,4 +265,5 @@ ISR(TWI_vect) {
 			TWCR = _BV(TWEN) | _BV(TWINT) | _BV(TWIE) | _BV(TWEA);
 			break;
 	}
+	ISR_PROFILE_EXIT(ISRPROF_TWI);
 }
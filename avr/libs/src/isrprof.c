@@ -0,0 +1,57 @@
+#include <stdint.h>
+#include <string.h>
+#include <util/atomic.h>
+#include <avr/pgmspace.h>
+#include "isrprof.h"
+
+uint16_t isrprofHits[ISRPROF_VECTORS];
+
+/*
+ * @see isrprof.h
+ */
+void isrprof_getHits(uint16_t * hits) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		memcpy(hits, isrprofHits, sizeof(isrprofHits));
+	}
+}
+
+#if defined(ISR_PROFILE)
+
+struct isrprof_stats isrprofStats[ISRPROF_VECTORS];
+
+static const char vectorNames[ISRPROF_VECTORS][13] PROGMEM = {
+	"TIMER0_COMPA", "TIMER1_CAPT", "TIMER1_COMPA", "SPI_STC", "USART_RX",
+	"USART_UDRE", "TWI", "INT0", "ACCEL_INT2", "BOX_SWITCH"
+};
+
+/*
+ * @see isrprof.h
+ */
+void isrprof_get(struct isrprof_stats * stats) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		memcpy(stats, isrprofStats, sizeof(isrprofStats));
+	}
+}
+
+/*
+ * @see isrprof.h
+ */
+PGM_P isrprof_getName(uint8_t vector) {
+	return (vector < ISRPROF_VECTORS) ? vectorNames[vector] : PSTR("");
+}
+
+/*
+ * @see isrprof.h
+ */
+void isrprof_reset() {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		for (uint8_t i = 0; i < ISRPROF_VECTORS; i++) {
+			isrprofStats[i].count = 0;
+			isrprofStats[i].total = 0;
+			isrprofStats[i].min = 0;
+			isrprofStats[i].max = 0;
+		}
+	}
+}
+
+#endif /* ISR_PROFILE */
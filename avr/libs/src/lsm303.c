@@ -1,5 +1,6 @@
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 #include <avr/sfr_defs.h>
 #include "lsm303.h"
 #include "pin_config.h"
@@ -108,6 +109,10 @@
 #define	LSM303_XHIE_XUPE		(1)
 #define LSM303_XLIE_XDOWNE		(0)
 
+// INT2_CFG_A (34h), same layout as INT1_CFG_A
+#define LSM303_INT2_ALL_AXES	(0x3F)
+#define LSM303_INT2_4D_AXES		(0x0F)
+
 // INT1_SRC_A (31h)
 #define LSM303_IA		(6)
 #define LSM303_ZH		(5)
@@ -127,20 +132,68 @@
 
 static void decodeReading(uint8_t * rawReading, struct lsm303_accel_reading * reading);
 
+// CTRL_REG1_A to CTRL_REG4_A, written in a single burst by lsm303_set_mode()
+#define CTRL_BURST_SIZE	(4)
+static uint8_t ctrlRegs[CTRL_BURST_SIZE];
+
+#define ctrlReg1 ctrlRegs[0]
+#define ctrlReg2 ctrlRegs[1]
+#define ctrlReg3 ctrlRegs[2]
+#define ctrlReg4 ctrlRegs[3]
+
+// CTRL_REG5_A and CTRL_REG6_A are shared by INT1, INT2 and click config
+static uint8_t ctrlReg5 = 0;
+static uint8_t ctrlReg6 = 0;
+
+/**
+ * Writes a single register of the accelerometer.
+ * 
+ * @param reg Register address
+ * @param value Value to write
+ */
+static inline int writeRegister(uint8_t reg, uint8_t value) {
+	return i2c_master_write(LSM303DLHC_ADDRESS_LIN_ACCEL, reg, &value, 1);
+}
+
+/**
+ * Reads a single register of the accelerometer.
+ * 
+ * @param reg Register address
+ * @return The register value
+ */
+static inline uint8_t readRegister(uint8_t reg) {
+	uint8_t value = 0;
+	i2c_master_read(LSM303DLHC_ADDRESS_LIN_ACCEL, reg, &value, 1);
+	return value;
+}
+
 /*
  * @see lsm303.h
  */
 int lsm303_init(enum lsm303_data_rate rate, enum lsm303_full_scale scale) {
-	uint8_t ctrlRegValue;
-	// Set ACCEL_CTRL_REG1_A: Output Data Rate and Enable all axis
-	ctrlRegValue = (rate << (LSM303_ODR)) | _BV(LSM303_ZEN) | _BV(LSM303_YEN) | _BV(LSM303_XEN);
-	i2c_master_write(LSM303DLHC_ADDRESS_LIN_ACCEL, LSM303_REGISTER_ACCEL_CTRL_REG1_A, &ctrlRegValue, 1);
+	return lsm303_set_mode(rate, scale, LSM303_MODE_NORMAL);
+}
+
+/*
+ * @see lsm303.h
+ */
+int lsm303_set_mode(enum lsm303_data_rate rate, enum lsm303_full_scale scale, enum lsm303_power_mode mode) {
+	// Set ACCEL_CTRL_REG1_A: Output Data Rate, Low power and Enable all axis
+	ctrlReg1 = (rate << (LSM303_ODR)) | _BV(LSM303_ZEN) | _BV(LSM303_YEN) | _BV(LSM303_XEN);
+	if (mode == LSM303_MODE_LOW_POWER) {
+		ctrlReg1 |= _BV(LSM303_LPEN);
+	}
 	
-	// Set ACCEL_CTRL_REG4_A: Full-scale selection, 
-	ctrlRegValue = (scale << (LSM303_FS));
-	i2c_master_write(LSM303DLHC_ADDRESS_LIN_ACCEL, LSM303_REGISTER_ACCEL_CTRL_REG4_A, &ctrlRegValue, 1);
+	// Set ACCEL_CTRL_REG4_A: Full-scale selection and High resolution
+	ctrlReg4 = (scale << (LSM303_FS));
+	if (mode == LSM303_MODE_HIGH_RESOLUTION) {
+		ctrlReg4 |= _BV(LSM303_HR);
+	}
 	
-	return 1;
+	// CTRL_REG1_A to CTRL_REG4_A in auto-increment mode, REG2/REG3 are rewritten from cache
+	return i2c_master_write(LSM303DLHC_ADDRESS_LIN_ACCEL, 
+							(LSM303_REGISTER_ACCEL_CTRL_REG1_A | LSM303_REGISTER_AUTO_INC), 
+							ctrlRegs, CTRL_BURST_SIZE);
 }
 
 /*
@@ -150,12 +203,12 @@ int lsm303_set_interrupt(uint8_t threshold, uint8_t duration) {
 	uint8_t ctrlRegValue;
 	
 	// Enable And/Or interrupt on INT1
-	ctrlRegValue = _BV(LSM303_L1_AOI1);
-	i2c_master_write(LSM303DLHC_ADDRESS_LIN_ACCEL, LSM303_REGISTER_ACCEL_CTRL_REG3_A, &ctrlRegValue, 1);
+	ctrlReg3 |= _BV(LSM303_L1_AOI1);
+	writeRegister(LSM303_REGISTER_ACCEL_CTRL_REG3_A, ctrlReg3);
 	
 	// Latch interrupt on INT1
-	ctrlRegValue = _BV(LSM303_LIR_INT1);
-	i2c_master_write(LSM303DLHC_ADDRESS_LIN_ACCEL, LSM303_REGISTER_ACCEL_CTRL_REG5_A, &ctrlRegValue, 1);
+	ctrlReg5 |= _BV(LSM303_LIR_INT1);
+	writeRegister(LSM303_REGISTER_ACCEL_CTRL_REG5_A, ctrlReg5);
 	
 	// OR combination
 	// YHigh and X High
@@ -173,6 +226,79 @@ int lsm303_set_interrupt(uint8_t threshold, uint8_t duration) {
 	return 1;
 }
 
+/*
+ * @see lsm303.h
+ */
+int lsm303_set_click(uint8_t axes, uint8_t threshold, uint8_t timeLimit, uint8_t latency, uint8_t window) {
+	// High-pass the click engine so gravity doesn't hold an axis over the
+	// threshold, HPCF at 0 is the highest cut-off. The outputs are not filtered.
+	ctrlReg2 |= _BV(LSM303_HPCLICK);
+	writeRegister(LSM303_REGISTER_ACCEL_CTRL_REG2_A, ctrlReg2);
+	
+	writeRegister(LSM303_REGISTER_ACCEL_CLICK_CFG_A, axes & 0b00111111);
+	// Mask the threshold and time limit so it keeps the MSB at 0
+	writeRegister(LSM303_REGISTER_ACCEL_CLICK_THS_A, threshold & 0b01111111);
+	writeRegister(LSM303_REGISTER_ACCEL_TIME_LIMIT_A, timeLimit & 0b01111111);
+	writeRegister(LSM303_REGISTER_ACCEL_TIME_LATENCY_A, latency);
+	writeRegister(LSM303_REGISTER_ACCEL_TIME_WINDOW_A, window);
+	
+	// Route click on INT2
+	ctrlReg6 |= _BV(LSM303_I2_CLICK_EN);
+	writeRegister(LSM303_REGISTER_ACCEL_CTRL_REG6_A, ctrlReg6);
+	
+	return 1;
+}
+
+/*
+ * @see lsm303.h
+ */
+int lsm303_set_orientation_interrupt(enum lsm303_orientation_mode mode, uint8_t threshold, uint8_t duration) {
+	bool fourD = (mode == LSM303_ORIENTATION_4D_MOVEMENT || mode == LSM303_ORIENTATION_4D_POSITION);
+	bool position = (mode == LSM303_ORIENTATION_6D_POSITION || mode == LSM303_ORIENTATION_4D_POSITION);
+	uint8_t cfg;
+	
+	// Latch interrupt on INT2 and 4D option
+	ctrlReg5 |= _BV(LSM303_LIR_INT2);
+	if (fourD) {
+		ctrlReg5 |= _BV(LSM303_D4D_INT2);
+	} else {
+		ctrlReg5 &= ~_BV(LSM303_D4D_INT2);
+	}
+	writeRegister(LSM303_REGISTER_ACCEL_CTRL_REG5_A, ctrlReg5);
+	
+	// 6D recognition with AOI selecting position (AND) or movement (OR)
+	cfg = _BV(LSM303_R6D) | (fourD ? LSM303_INT2_4D_AXES : LSM303_INT2_ALL_AXES);
+	if (position) {
+		cfg |= _BV(LSM303_AOI);
+	}
+	writeRegister(LSM303_REGISTER_ACCEL_INT2_CFG_A, cfg);
+	
+	// Mask the threshold and duration so it keeps the MSB at 0
+	writeRegister(LSM303_REGISTER_ACCEL_INT2_THS_A, threshold & 0b01111111);
+	writeRegister(LSM303_REGISTER_ACCEL_INT2_DURATION_A, duration & 0b01111111);
+	
+	// Route INT2 function on the INT2 pin
+	ctrlReg6 |= _BV(LSM303_I2_INT2);
+	writeRegister(LSM303_REGISTER_ACCEL_CTRL_REG6_A, ctrlReg6);
+	
+	return 1;
+}
+
+/*
+ * @see lsm303.h
+ */
+int lsm303_clear_orientation_interrupt() {
+	// Read interrupt source -> Also clears latched interrupt
+	return readRegister(LSM303_REGISTER_ACCEL_INT2_SOURCE_A);
+}
+
+/*
+ * @see lsm303.h
+ */
+int lsm303_clear_click() {
+	return readRegister(LSM303_REGISTER_ACCEL_CLICK_SRC_A);
+}
+
 /*
  * @see lsm303.h
  */
@@ -192,9 +318,14 @@ int lsm303_read(struct lsm303_accel_reading * reading) {
 	uint8_t rawReading[ACCEL_READING_SIZE];
 	
 	// Read status + all 6 registers in auto-increment mode for the raw register values
-	i2c_master_read(LSM303DLHC_ADDRESS_LIN_ACCEL, 
+	if (i2c_master_read(LSM303DLHC_ADDRESS_LIN_ACCEL, 
 					(LSM303_REGISTER_ACCEL_STATUS_REG_A | LSM303_REGISTER_AUTO_INC), 
-					rawReading, ACCEL_READING_SIZE);
+					rawReading, ACCEL_READING_SIZE) != 0) {
+		// No answer of the LSM303, the buffer is not a reading
+		reading->rawStatus = 0;
+		reading->status = LSM303_DATA_NREADY;
+		return 0;
+	}
 
 	reading->rawStatus = rawReading[0];
 	
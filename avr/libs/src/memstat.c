@@ -0,0 +1,53 @@
+#include <stdint.h>
+#include <avr/io.h>
+#include "memstat.h"
+
+// Symbols of the avr-libc linker script and malloc()
+extern uint8_t __data_start;
+extern uint8_t __data_end;
+extern uint8_t __bss_start;
+extern uint8_t __bss_end;
+extern uint8_t __heap_start;
+extern uint8_t * __brkval;
+
+void memstat_paint(void) __attribute__((naked, used, section(".init3")));
+
+/**
+ * Paints the RAM from the end of .bss to the stack pointer.
+ * 
+ * Runs in .init3: the stack pointer and the zero register are set, the
+ * .data and .bss are not initialized yet. Naked so nothing is pushed.
+ */
+void memstat_paint(void) {
+	uint8_t * p = &__heap_start;
+	
+	while (p <= (uint8_t *) SP) {
+		*p++ = MEMSTAT_CANARY;
+	}
+}
+
+/**
+ * Returns the first byte above the heap.
+ */
+static inline uint8_t * heapTop() {
+	return (__brkval != 0) ? __brkval : &__heap_start;
+}
+
+/*
+ * @see memstat.h
+ */
+void memstat_get(struct memstat * stat) {
+	uint8_t * top = heapTop();
+	uint8_t * p = top;
+	
+	while (p <= (uint8_t *) RAMEND && *p == MEMSTAT_CANARY) {
+		p++;
+	}
+	
+	stat->data = &__data_end - &__data_start;
+	stat->bss = &__bss_end - &__bss_start;
+	stat->heap = top - &__heap_start;
+	stat->stackFree = (uint8_t *) SP - top;
+	stat->stackUnused = p - top;
+	stat->stackPeak = (uint8_t *) RAMEND - p + 1;
+}
@@ -0,0 +1,257 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include "motion.h"
+#include "servo.h"
+#include "timerwheel.h"
+
+// Positions in Q8 degrees, velocity in Q8 degrees/tick
+#define POSITION_FRAC	(8)
+
+struct motionChannel {
+	int32_t position;
+	int32_t target;
+	int16_t velocity;
+	int16_t maxVelocity;
+	int16_t acceleration;
+	int32_t triggerPosition;
+	bool moving;
+	void (*done)(int);
+	void (*trigger)(int);
+};
+
+static struct motionChannel channels[MOTION_CHANNELS];
+static struct timer tickTimer;
+static bool timerReady = false;
+
+static void tick(void * arg);
+
+/**
+ * Converts degrees/s to Q8 degrees/tick.
+ */
+static inline int16_t toTickVelocity(uint16_t velocity) {
+	int32_t value = ((uint32_t) velocity << POSITION_FRAC) * MOTION_TICK_MS / 1000;
+	if (value > INT16_MAX) {
+		return INT16_MAX;
+	}
+	return (value > 0) ? value : 1;
+}
+
+/**
+ * Converts degrees/s^2 to Q8 degrees/tick^2.
+ * 
+ * The product needs 64 bits over about 41900 degrees/s^2.
+ */
+static inline int16_t toTickAcceleration(uint16_t acceleration) {
+	int32_t value = ((uint64_t) acceleration << POSITION_FRAC) * MOTION_TICK_MS * MOTION_TICK_MS / 1000000;
+	if (value > INT16_MAX) {
+		return INT16_MAX;
+	}
+	return (value > 0) ? value : 1;
+}
+
+/**
+ * Writes the profile position to the servo, rounded to a tenth of a degree.
+ */
+static inline void output(int channel) {
+	servo_write(channel, (SERVO_DEGREES(channels[channel].position) + (1 << (POSITION_FRAC - 1))) >> POSITION_FRAC);
+}
+
+/**
+ * Checks whether a channel index is valid.
+ */
+static inline bool isValid(int channel) {
+	return channel >= 0 && channel < MOTION_CHANNELS;
+}
+
+/**
+ * Calls the trigger of a channel if the profile crossed its angle
+ * between two positions.
+ */
+static void checkTrigger(int channel, int32_t from, int32_t to) {
+	struct motionChannel * c = &channels[channel];
+	void (*trigger)(int) = c->trigger;
+	
+	if (trigger == NULL) {
+		return;
+	}
+	if ((from <= c->triggerPosition && to >= c->triggerPosition)
+			|| (from >= c->triggerPosition && to <= c->triggerPosition)) {
+		c->trigger = NULL;
+		trigger(channel);
+	}
+}
+
+/*
+ * @see motion.h
+ */
+int motion_move(int channel, int angle, uint16_t velocity, uint16_t acceleration, void (*done)(int)) {
+	if (!isValid(channel) || angle < 0 || SERVO_DEGREES(angle) > MAX_ANGLE) {
+		return -1;
+	}
+	
+	struct motionChannel * c = &channels[channel];
+	
+	if (!c->moving) {
+		c->position = ((int32_t) servo_read(channel) << POSITION_FRAC) / SERVO_DEGREES(1);
+		c->velocity = 0;
+	}
+	c->target = (int32_t) angle << POSITION_FRAC;
+	c->done = done;
+	
+	// No profile, jump to the target
+	if (velocity == 0) {
+		int32_t from = c->position;
+		c->moving = false;
+		c->position = c->target;
+		output(channel);
+		checkTrigger(channel, from, c->position);
+		if (done != NULL) {
+			done(channel);
+		}
+		return 0;
+	}
+	
+	c->maxVelocity = toTickVelocity(velocity);
+	c->acceleration = (acceleration == 0) ? c->maxVelocity : toTickAcceleration(acceleration);
+	c->moving = true;
+	
+	if (!timerReady) {
+		timer_init(&tickTimer, tick, NULL);
+		timerReady = true;
+	}
+	if (!timer_isActive(&tickTimer)) {
+		timer_start(&tickTimer, MOTION_TICK_MS, MOTION_TICK_MS);
+	}
+	
+	return 0;
+}
+
+/*
+ * @see motion.h
+ */
+int motion_setTrigger(int channel, int angle, void (*trigger)(int)) {
+	if (!isValid(channel) || angle < 0 || SERVO_DEGREES(angle) > MAX_ANGLE) {
+		return -1;
+	}
+	channels[channel].triggerPosition = (int32_t) angle << POSITION_FRAC;
+	channels[channel].trigger = trigger;
+	return 0;
+}
+
+/*
+ * @see motion.h
+ */
+int motion_stop(int channel) {
+	if (!isValid(channel)) {
+		return -1;
+	}
+	channels[channel].trigger = NULL;
+	channels[channel].moving = false;
+	channels[channel].velocity = 0;
+	return 0;
+}
+
+/*
+ * @see motion.h
+ */
+bool motion_isDone(int channel) {
+	return !isValid(channel) || !channels[channel].moving;
+}
+
+/*
+ * @see motion.h
+ */
+int motion_position(int channel) {
+	if (!isValid(channel)) {
+		return -1;
+	}
+	if (!channels[channel].moving) {
+		return (servo_read(channel) + SERVO_DEGREES(1) / 2) / SERVO_DEGREES(1);
+	}
+	return (channels[channel].position + (1 << (POSITION_FRAC - 1))) >> POSITION_FRAC;
+}
+
+/**
+ * Steps the trapezoidal profile of a channel.
+ * 
+ * The speed along the direction of the target decreases when the 
+ * stopping distance at the current speed reaches the remaining distance,
+ * otherwise it increases up to the maximum. A channel moving away from
+ * a new target first decelerates to a stop.
+ * 
+ * @return true if the channel reached its target
+ */
+static bool step(struct motionChannel * c) {
+	int32_t remaining = c->target - c->position;
+	int8_t direction = (remaining >= 0) ? 1 : -1;
+	int32_t distance = labs(remaining);
+	int32_t speed = (int32_t) c->velocity * direction;
+	int32_t stopping = (speed > 0) ? (speed * speed) / (2 * (int32_t) c->acceleration) : 0;
+	
+	if (speed < 0) {
+		// Reversal, braking ends at a stop
+		speed += c->acceleration;
+		if (speed > 0) {
+			speed = 0;
+		}
+	} else if (stopping >= distance) {
+		speed -= c->acceleration;
+		// Keep a minimum crawl so the target is always reached
+		if (speed < c->acceleration) {
+			speed = c->acceleration;
+		}
+	} else {
+		speed += c->acceleration;
+		if (speed > c->maxVelocity) {
+			speed = c->maxVelocity;
+		}
+	}
+	
+	if (distance <= speed) {
+		c->position = c->target;
+		c->velocity = 0;
+		return true;
+	}
+	
+	c->position += speed * direction;
+	c->velocity = speed * direction;
+	return false;
+}
+
+/**
+ * Timer callback for the profile steps of every moving channel.
+ * 
+ * The timer is stopped when no channel is moving.
+ */
+static void tick(void * arg) {
+	bool active = false;
+	
+	for (uint8_t channel = 0; channel < MOTION_CHANNELS; channel++) {
+		struct motionChannel * c = &channels[channel];
+		if (!c->moving) {
+			continue;
+		}
+		
+		int32_t from = c->position;
+		bool reached = step(c);
+		output(channel);
+		checkTrigger(channel, from, c->position);
+		
+		if (reached) {
+			c->moving = false;
+			if (c->done != NULL) {
+				c->done(channel);
+			}
+		}
+	}
+	
+	// Callbacks may have started new moves on any channel
+	for (uint8_t channel = 0; channel < MOTION_CHANNELS; channel++) {
+		active |= channels[channel].moving;
+	}
+	if (!active) {
+		timer_stop(&tickTimer);
+	}
+}
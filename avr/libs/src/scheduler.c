@@ -0,0 +1,98 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "scheduler.h"
+#include "systick.h"
+#include "cycles.h"
+#include "servo.h"
+
+// The cycle timestamps wrap on every servo frame
+#define FRAME_MS			(SERVO_FRAME_TICKS / (F_CPU / 1000 / SERVO_PRESCALER))
+#define CYCLES_PER_MS		(F_CPU / 1000)
+
+static struct task * tasks = NULL;
+static uint8_t taskCount = 0;
+
+/**
+ * Runs a task and updates its statistics.
+ */
+static void runTask(struct task * task) {
+	uint32_t startMs = systick_millis();
+	uint16_t start = cycles_now();
+	
+	task->run();
+	
+	uint32_t elapsed = cycles_elapsed(start);
+	uint32_t elapsedMs = systick_elapsed(startMs);
+	if (elapsedMs >= FRAME_MS) {
+		elapsed = elapsedMs * CYCLES_PER_MS;
+	}
+	
+	task->count++;
+	task->cycles += elapsed;
+	if (elapsed > task->worst) {
+		task->worst = elapsed;
+	}
+}
+
+/*
+ * @see scheduler.h
+ */
+void scheduler_init(struct task * table, uint8_t count) {
+	uint32_t now = systick_millis();
+	
+	// Insertion sort, equal priorities keep the order of the table
+	for (uint8_t i = 1; i < count; i++) {
+		struct task task = table[i];
+		uint8_t j = i;
+		
+		while (j > 0 && table[j - 1].priority > task.priority) {
+			table[j] = table[j - 1];
+			j--;
+		}
+		table[j] = task;
+	}
+	
+	tasks = table;
+	taskCount = count;
+	for (uint8_t i = 0; i < count; i++) {
+		tasks[i].lastRun = now;
+	}
+	scheduler_resetStats();
+}
+
+/*
+ * @see scheduler.h
+ */
+void scheduler_run(uint8_t events) {
+	uint32_t now = systick_millis();
+	
+	for (uint8_t i = 0; i < taskCount; i++) {
+		struct task * task = &tasks[i];
+		bool ready = (task->events & events) != 0;
+		
+		if (task->period != 0 && now - task->lastRun >= task->period) {
+			// Keep the phase, unless runs were missed
+			task->lastRun += task->period;
+			if (now - task->lastRun >= task->period) {
+				task->lastRun = now;
+			}
+			ready = true;
+		}
+		
+		if (ready) {
+			runTask(task);
+		}
+	}
+}
+
+/*
+ * @see scheduler.h
+ */
+void scheduler_resetStats() {
+	for (uint8_t i = 0; i < taskCount; i++) {
+		tasks[i].count = 0;
+		tasks[i].cycles = 0;
+		tasks[i].worst = 0;
+	}
+}
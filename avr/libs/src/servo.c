@@ -3,127 +3,436 @@
  */
 
 #include "servo.h"
-#include "pin_config.h"
 #include "ioctl.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include "timerwheel.h"
+#include "isrprof.h"
 #include <avr/interrupt.h>
+#include <util/atomic.h>
 
+// Fractional bits of the ticks per tenth of a degree
+#define SCALE_FRAC 12
 
-// ISR to set pulse to ServoB on overflow
-ISR(TIMER1_OVF_vect) {
-    ioctl_write(&SERVO_B_PORT, SERVO_B_IO, 1);
+// Pulse ends closer than this to the current one are cleared in the same
+// interrupt, by waiting for their tick, instead of a new compare match
+#define GUARD_TICKS (16 * SERVO_TICKS_PER_US)
+
+struct servoChannel {
+    volatile uint8_t * port;
+    uint8_t mask;
+    uint8_t output;
+    bool enabled;     // Initialized by servo_channel_init_angle()
+    bool attached;    // Pulses are generated
+    uint16_t holdTime;
+    struct timer holdTimer;
+    uint16_t minTicks;
+    uint16_t scale;   // Ticks per tenth of a degree in Q12
+    uint16_t ticks;   // Current pulse width
+    int16_t angle;
+};
+
+/**
+ * End of a pulse in the frame.
+ */
+struct pulseEnd {
+    volatile uint8_t * port;
+    uint8_t mask;
+    uint16_t ticks;
+};
+
+/**
+ * Pins set at the start of the frame, one entry per port.
+ */
+struct pulseStart {
+    volatile uint8_t * port;
+    uint8_t mask;
+};
+
+/**
+ * Timer1 frame: the pulse ends are sorted by ticks.
+ */
+struct schedule {
+    uint8_t startCount;
+    uint8_t endCount;
+    struct pulseStart starts[SERVO_MAX_CHANNELS];
+    struct pulseEnd ends[SERVO_MAX_CHANNELS];
+};
+
+static struct servoChannel channels[SERVO_MAX_CHANNELS];
+static uint8_t channelCount;
+
+// The ISR runs the active schedule, the other one is built by updateSchedule()
+static struct schedule schedules[2];
+static volatile uint8_t activeSchedule;
+static volatile bool scheduleReady;
+static uint8_t nextEnd;
+
+/**
+ * Converts a pulse width in us to ticks of the timer of a channel
+ */
+static inline uint16_t pulseTicks(int channel, uint16_t pulse) {
+    if(channels[channel].output == SERVO_OUTPUT_TIMER2) {
+        return (pulse + SERVO_TIMER2_TICK_US / 2) / SERVO_TIMER2_TICK_US;
+    }
+    return pulse * SERVO_TICKS_PER_US;
 }
 
-// ISR to clear pulse to ServoB on CompareMatch
-ISR(TIMER1_COMPB_vect) {
-    ioctl_write(&SERVO_B_PORT, SERVO_B_IO, 0);
+/**
+ * Sets the minimum pulse and scale of a channel from its pulse widths in us
+ */
+static void setPulses(int channel, uint16_t minPulse, uint16_t maxPulse) {
+    uint16_t minTicks = pulseTicks(channel, minPulse);
+    uint32_t span = pulseTicks(channel, maxPulse) - minTicks;
+
+    channels[channel].minTicks = minTicks;
+    channels[channel].scale = (span << SCALE_FRAC) / MAX_ANGLE;
+}
+
+/**
+ * Converts an angle to the compare value of a channel, a 16x16 multiply
+ */
+static inline uint16_t toTicks(int channel, int angle) {
+    struct servoChannel * c = &channels[channel];
+    return c->minTicks + (((uint32_t) angle * c->scale + (1UL << (SCALE_FRAC - 1))) >> SCALE_FRAC);
+}
+
+/**
+ * Checks whether a channel index is valid.
+ */
+static inline bool isValid(int channel) {
+    return channel >= 0 && channel < channelCount;
+}
+
+/**
+ * Builds the Timer1 frame from the attached channels, it is used by the
+ * interrupt from the next frame.
+ */
+static void updateSchedule() {
+    // The interrupt must not switch to a half-built schedule
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        scheduleReady = false;
+    }
+
+    struct schedule * s = &schedules[activeSchedule ^ 1];
+    s->startCount = 0;
+    s->endCount = 0;
+
+    for(uint8_t channel = 0; channel < channelCount; channel++) {
+        struct servoChannel * c = &channels[channel];
+        if(!c->attached || c->output != SERVO_OUTPUT_TIMER1) {
+            continue;
+        }
+
+        // Start pins, merged by port
+        uint8_t i = 0;
+        while(i < s->startCount && s->starts[i].port != c->port) {
+            i++;
+        }
+        if(i == s->startCount) {
+            s->starts[i].port = c->port;
+            s->starts[i].mask = 0;
+            s->startCount++;
+        }
+        s->starts[i].mask |= c->mask;
+
+        // Insertion in pulse width order
+        i = s->endCount;
+        while(i > 0 && s->ends[i - 1].ticks > c->ticks) {
+            s->ends[i] = s->ends[i - 1];
+            i--;
+        }
+        s->ends[i].port = c->port;
+        s->ends[i].mask = c->mask;
+        s->ends[i].ticks = c->ticks;
+        s->endCount++;
+    }
+
+    scheduleReady = true;
+}
+
+/**
+ * Start of the Timer1 frame (TOP in CTC mode), all the pulses are set.
+ */
+ISR(TIMER1_CAPT_vect) {
+    ISR_PROFILE_ENTER();
+    if(scheduleReady) {
+        activeSchedule ^= 1;
+        scheduleReady = false;
+    }
+
+    const struct schedule * s = &schedules[activeSchedule];
+    for(uint8_t i = 0; i < s->startCount; i++) {
+        *s->starts[i].port |= s->starts[i].mask;
+    }
+
+    nextEnd = 0;
+    if(s->endCount > 0) {
+        OCR1A = s->ends[0].ticks;
+        TIFR1 = (1 << OCF1A);
+        TIMSK1 |= (1 << OCIE1A);
+    }
+    ISR_PROFILE_EXIT(ISRPROF_TIMER1_CAPT);
+}
+
+/**
+ * End of the next pulse, the following compare match is programmed.
+ */
+ISR(TIMER1_COMPA_vect) {
+    ISR_PROFILE_ENTER();
+    const struct schedule * s = &schedules[activeSchedule];
+
+    *s->ends[nextEnd].port &= ~s->ends[nextEnd].mask;
+    nextEnd++;
+
+    while(nextEnd < s->endCount && s->ends[nextEnd].ticks <= TCNT1 + GUARD_TICKS) {
+        while(TCNT1 < s->ends[nextEnd].ticks) {
+            // Wait for the end of the pulse
+        }
+        *s->ends[nextEnd].port &= ~s->ends[nextEnd].mask;
+        nextEnd++;
+    }
+
+    if(nextEnd < s->endCount) {
+        OCR1A = s->ends[nextEnd].ticks;
+    } else {
+        TIMSK1 &= ~(1 << OCIE1A);
+    }
+    ISR_PROFILE_EXIT(ISRPROF_TIMER1_COMPA);
+}
+
+/**
+ * Starts the pulses of a channel.
+ */
+static void attach(int channel) {
+    channels[channel].attached = true;
+
+    if(channels[channel].output == SERVO_OUTPUT_TIMER2) {
+        OCR2B = channels[channel].ticks;
+
+        // Fast PWM with 0xFF as top, clear OC2B on Compare Match and set at bottom
+        TCCR2A = (1 << COM2B1) | (1 << WGM21) | (1 << WGM20);
+
+        // Set prescalar to 1024, 16MHz/1024/256 = 61Hz frame
+        TCCR2B = (1 << CS22) | (1 << CS21) | (1 << CS20);
+    } else {
+        updateSchedule();
+    }
+}
+
+/**
+ * Stops the pulses of a channel, the output stays low.
+ *
+ * A pulse in progress is never truncated: the Timer1 frame in progress
+ * completes with the old schedule. OC2B is disconnected between the end
+ * of its pulse and the next bottom, otherwise the hold timer is re-armed
+ * for the end of the pulse and the channel stays attached until then.
+ */
+static void detach(int channel) {
+    struct servoChannel * c = &channels[channel];
+
+    if(c->output == SERVO_OUTPUT_TIMER2) {
+        uint8_t count;
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            count = TCNT2;
+            // The last tick before bottom is skipped, OC2B would be set by the wrap
+            if(count > OCR2B && count < 0xFF) {
+                TCCR2A = (1 << WGM21) | (1 << WGM20);
+            }
+        }
+        if(count <= OCR2B || count == 0xFF) {
+            uint16_t remaining = (count <= OCR2B) ? (OCR2B + 1 - count) * SERVO_TIMER2_TICK_US : SERVO_TIMER2_TICK_US;
+            timer_start(&c->holdTimer, remaining / 1000 + 1, 0);
+            return;
+        }
+        c->attached = false;
+    } else {
+        c->attached = false;
+        updateSchedule();
+    }
+}
+
+/**
+ * Timer callback at the end of the hold time of a channel.
+ */
+static void holdExpired(void * arg) {
+    detach((uintptr_t) arg);
 }
 
 /**
  * Initializes the Servo library by setting up Timer1
- * 
+ *
  * @return 0 on success, negative on error
  */
-int servo_init() {
+int servo_init(const struct servo_descriptor * table, uint8_t count) {
+    if(count > SERVO_MAX_CHANNELS) {
+        return -1;
+    }
+
+    channelCount = count;
+    for(uint8_t channel = 0; channel < count; channel++) {
+        const struct servo_descriptor * d = &table[channel];
+        struct servoChannel * c = &channels[channel];
+
+        c->port = d->port;
+        c->mask = (1 << d->pin);
+        c->output = d->output;
+        c->enabled = false;
+        c->attached = false;
+        c->holdTime = 0;
+        timer_init(&c->holdTimer, holdExpired, (void *) (uintptr_t) channel);
+        setPulses(channel, d->minPulse ? d->minPulse : SERVO_MIN_PULSE_US, d->maxPulse ? d->maxPulse : SERVO_MAX_PULSE_US);
+        c->angle = NEUTRAL_ANGLE;
+        c->ticks = toTicks(channel, c->angle);
+
+        ioctl_write(d->port, d->pin, 0);
+        ioctl_setdir(d->ddr, d->pin, OUTPUT);
+    }
 
-    // Use fast PWM, non-inverted with ICR1 as top 
-    TCCR1B |= (1 << WGM13) |  (1 << WGM12);
-    TCCR1A |= (1 << WGM11);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        // CTC with ICR1 as TOP, no output compare pin
+        TCCR1A = 0;
+        TCCR1B = (1 << WGM13) | (1 << WGM12);
 
-    // Set prescalar to 64
-    TCCR1B |= (1 << CS11) | (1 << CS10);
+        // Set ICR1 (TOP) for a 20ms frame
+        ICR1 = SERVO_FRAME_TICKS - 1;
 
-    // Set ICR1 (TOP) to 5000 - b/c we increment counter at 250 000 Hz, want 50 Hz frequency
-    // giving us 250 000/50 = 5000
-    ICR1 = 5000;
+        // Finally, we'll set the initial value of the counter
+        TCNT1 = 0;
 
-    // Finally, we'll set the initial value of the counter
-    TCNT1 = 0;
+        activeSchedule = 0;
+        scheduleReady = false;
+        schedules[0].startCount = 0;
+        schedules[0].endCount = 0;
+
+        // Frame interrupt and prescaler 8 starts the timer
+        TIMSK1 = (1 << ICIE1);
+        TCCR1B |= (1 << CS11);
+    }
 
     return 0;
 }
 
 /**
  * Initializes the desired channel for a servo motor at neutral
- * 
+ *
  * @return 0 on success, negative on error
  */
 int servo_channel_init(int channel) {
-    return servo_channel_init_angle(channel, 90);
+    return servo_channel_init_angle(channel, NEUTRAL_ANGLE);
 }
 
 /**
  * Initializes the desired channel for a servo motor with the indicated
  * starting angle
- * 
+ *
  * @return 0 on success, negative on error
  */
 int servo_channel_init_angle(int channel, int angle) {
-    if(channel == SERVO_CHANNELA) {
-        // Clear OC1x on Compare Match and set at bottom
-        TCCR1A |= (1 << COM1A1);
-
-        // Set the initial position and turn on output
-        OCR1A = BASE_VALUE + ((long) angle * UNITS_PER_DEGREE);
-        ioctl_setdir(&SERVO_A_DDR, SERVO_A_IO, OUTPUT);
-    } else if(channel == SERVO_CHANNELB) {
-        // Don't want to touch OC1B, so won't set anything for it!
-
-        // Turn on the interrupts!
-        TIMSK1 |= (1 << OCIE1B);
-        TIMSK1 |= (1 << TOIE1);
-
-        // Set the initial position and turn on output
-        OCR1B = BASE_VALUE + ((long) angle * UNITS_PER_DEGREE);
-        ioctl_setdir(&SERVO_B_DDR, SERVO_B_IO, OUTPUT);
-    } else {
-        // Invalid channel, return -1
+    if(!isValid(channel) || angle < MIN_ANGLE || angle > MAX_ANGLE) {
         return -1;
     }
 
-    return 0;
+    channels[channel].enabled = true;
+    return servo_write(channel, angle);
+}
+
+/**
+ * Sets the pulse widths of a channel at MIN_ANGLE and MAX_ANGLE.
+ *
+ * @return 0 on success, negative on error
+ */
+int servo_calibrate(int channel, uint16_t minPulse, uint16_t maxPulse) {
+    if(!isValid(channel) || maxPulse <= minPulse) {
+        return -1;
+    }
+
+    // The scale must fit in 16 bits
+    if(pulseTicks(channel, maxPulse) - pulseTicks(channel, minPulse) >= ((uint32_t) MAX_ANGLE << (16 - SCALE_FRAC))) {
+        return -1;
+    }
+
+    setPulses(channel, minPulse, maxPulse);
+    return servo_write(channel, channels[channel].angle);
 }
 
 /**
- * Moves the requested servo motor to the desired angle. Must be a value between 0 and 180
- * 
+ * Moves the requested servo motor to the desired angle. Must be a value between 0 and 1800
+ *
  * @param channel The Servo to be written to
- * @param angle The angle to move to (between 0 and 180)
+ * @param angle The angle to move to in tenths of a degree (between 0 and 1800)
  * @return 0 on success, negative on error
  */
 int servo_write(int channel, int angle) {
     // Check to ensure that angle is valid
-    if(angle < MIN_ANGLE || angle > MAX_ANGLE) {
+    if(!isValid(channel) || angle < MIN_ANGLE || angle > MAX_ANGLE) {
         return -1;
     }
-    
-    // Update the channel to the desired angle
-    if(channel == SERVO_CHANNELA) {
-        OCR1A = BASE_VALUE + ((long) angle * UNITS_PER_DEGREE);
-    } else if(channel == SERVO_CHANNELB) {
-        OCR1B = BASE_VALUE + (angle * UNITS_PER_DEGREE);
+
+    struct servoChannel * c = &channels[channel];
+    c->angle = angle;
+    c->ticks = toTicks(channel, angle);
+
+    if(!c->enabled) {
+        return 0;
+    }
+
+    // Update the channel to the desired angle, re-attached if idle
+    if(!c->attached) {
+        attach(channel);
+    } else if(c->output == SERVO_OUTPUT_TIMER2) {
+        OCR2B = c->ticks;
     } else {
-        // Invalid channel, return -1
+        updateSchedule();
+    }
+
+    if(c->holdTime != 0) {
+        timer_start(&c->holdTimer, c->holdTime, 0);
+    }
+
+    return 0;
+}
+
+/**
+ * Sets the time the pulses are kept after the last write of a channel.
+ *
+ * @return 0 on success, negative on error
+ */
+int servo_setHoldTime(int channel, uint16_t holdTime) {
+    if(!isValid(channel)) {
         return -1;
     }
 
+    struct servoChannel * c = &channels[channel];
+    c->holdTime = holdTime;
+    if(holdTime == 0) {
+        timer_stop(&c->holdTimer);
+    } else if(c->attached) {
+        timer_start(&c->holdTimer, holdTime, 0);
+    }
     return 0;
 }
 
+/**
+ * Checks whether the pulses of a channel are generated.
+ *
+ * @return true if attached, false if idle or not initialized
+ */
+bool servo_isAttached(int channel) {
+    return isValid(channel) && channels[channel].attached;
+}
+
 /**
  * Returns the current angle of the servo on the desired channel
- * 
+ *
  * @param channel The servo to read
- * @return the angle of the motor, between 0 and 180
+ * @return the last commanded angle in tenths of a degree, between 0 and 1800
  */
-long servo_read(int channel) {
-    if(channel == SERVO_CHANNELA) {
-        return (long) (OCR1A - BASE_VALUE) / UNITS_PER_DEGREE;
-    } else if (channel == SERVO_CHANNELB) {
-        return (long) (OCR1B - BASE_VALUE) / UNITS_PER_DEGREE;
+int servo_read(int channel) {
+    if(isValid(channel)) {
+        return channels[channel].angle;
     } else {
         return -1;
     }
 }
-
-
-
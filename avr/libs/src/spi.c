@@ -11,6 +11,8 @@
 
 #include "defineConfig.h"
 #include "spi.h"
+#include "isrprof.h"
+#include "trace.h"
 
 #if !defined(SPI_PORT) || !defined(SPI_DDR) || !defined(SPI_DD_SCK) || !defined(SPI_DD_MISO) || !defined(SPI_DD_MOSI) || !defined(SPI_DD_SS) || !defined(SPI_PIN)
 #error SPI PINS Configuration missing, see defineConfig.h
@@ -176,9 +178,11 @@ int spi_transmit_it(uint8_t *tx, uint8_t *rx, int size, void (*vector)(void)) {
 }
 
 ISR(SPI_STC_vect) {
+	ISR_PROFILE_ENTER();
 	// If we have a transfer complete and we're in slave IT mode 
 	// then initiate the callback
 	if ((SPCR & SPI_CONTROL_MASK) == SPI_CONTROL_SLAVE_IT) {
+		trace(TRACE_SPI_BYTE, SPDR);
 		isrVector();
 	}
 	// If we're in Master IT mode then continue transfer or callback if done
@@ -192,4 +196,5 @@ ISR(SPI_STC_vect) {
 			isrVector();
 		}
 	}
+	ISR_PROFILE_EXIT(ISRPROF_SPI_STC);
 }
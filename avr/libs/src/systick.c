@@ -0,0 +1,69 @@
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include "systick.h"
+#include "event.h"
+#include "isrprof.h"
+
+// 16MHz / 64 / 250 = 1kHz
+#define SYSTICK_TOP ((F_CPU / SYSTICK_PRESCALER / SYSTICK_HZ) - 1)
+
+#if SYSTICK_TOP > 255
+#error F_CPU too high for the Timer0 system tick
+#endif
+
+static volatile uint32_t millis = 0;
+
+/*
+ * @see systick.h
+ */
+int systick_init() {
+	// CTC mode with OCR0A as TOP
+	TCCR0A = _BV(WGM01);
+	OCR0A = SYSTICK_TOP;
+	TCNT0 = 0;
+	TIMSK0 = _BV(OCIE0A);
+	
+	// Prescaler 64 starts the timer
+	TCCR0B = _BV(CS01) | _BV(CS00);
+	
+	return 0;
+}
+
+/*
+ * @see systick.h
+ */
+uint32_t systick_millis() {
+	uint32_t value;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		value = millis;
+	}
+	return value;
+}
+
+/*
+ * @see systick.h
+ */
+uint16_t systick_stamp() {
+	uint8_t ticks = TCNT0;
+	uint16_t ms = millis;
+	
+	// The tick of this compare match is not counted yet
+	if (TIFR0 & _BV(OCF0A)) {
+		ticks = TCNT0;
+		ms++;
+	}
+	return (ms << 4) | (ticks >> 4);
+}
+
+/**
+ * Timer0 compare match, the 1ms tick.
+ */
+ISR(TIMER0_COMPA_vect) {
+	ISR_PROFILE_ENTER();
+	millis++;
+	event_post(EVENT_TIMER);
+	ISR_PROFILE_EXIT(ISRPROF_TIMER0_COMPA);
+}
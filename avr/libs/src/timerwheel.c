@@ -0,0 +1,159 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "timerwheel.h"
+#include "systick.h"
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+
+#if (TIMER_WHEEL_SLOTS & SLOT_MASK) != 0
+#error TIMER_WHEEL_SLOTS must be a power of 2
+#endif
+
+#define STATE_IDLE		(0)
+#define STATE_PENDING	(1) // In a wheel slot
+#define STATE_DUE		(2) // In the due list of the current dispatch
+
+static struct timer * wheel[TIMER_WHEEL_SLOTS];
+static struct timer * dueList = NULL;
+static uint32_t lastTick = 0;
+static bool started = false;
+
+/**
+ * Checks whether an absolute tick is reached.
+ */
+static inline bool isExpired(uint32_t expires, uint32_t now) {
+	return (int32_t) (expires - now) <= 0;
+}
+
+/**
+ * Removes a timer from a singly linked list.
+ * 
+ * @param head Pointer to the head of the list
+ * @param timer Timer to remove
+ */
+static void unlink(struct timer ** head, struct timer * timer) {
+	for (struct timer ** link = head; *link != NULL; link = &(*link)->next) {
+		if (*link == timer) {
+			*link = timer->next;
+			return;
+		}
+	}
+}
+
+/**
+ * Adds a timer in the slot of its expiry.
+ * 
+ * Timers already expired go in the next slot to be scanned.
+ */
+static void insert(struct timer * timer) {
+	uint32_t tick = isExpired(timer->expires, lastTick) ? lastTick + 1 : timer->expires;
+	
+	timer->slot = tick & SLOT_MASK;
+	timer->next = wheel[timer->slot];
+	wheel[timer->slot] = timer;
+	timer->state = STATE_PENDING;
+}
+
+/**
+ * Removes a timer from the wheel or due list.
+ */
+static void detach(struct timer * timer) {
+	if (timer->state == STATE_PENDING) {
+		unlink(&wheel[timer->slot], timer);
+	} else if (timer->state == STATE_DUE) {
+		unlink(&dueList, timer);
+	}
+	timer->state = STATE_IDLE;
+}
+
+/*
+ * @see timerwheel.h
+ */
+void timer_init(struct timer * timer, void (*callback)(void *), void * arg) {
+	timer->next = NULL;
+	timer->callback = callback;
+	timer->arg = arg;
+	timer->period = 0;
+	timer->state = STATE_IDLE;
+}
+
+/*
+ * @see timerwheel.h
+ */
+void timer_start(struct timer * timer, uint16_t delay, uint16_t period) {
+	uint32_t now = systick_millis();
+	
+	if (!started) {
+		lastTick = now;
+		started = true;
+	}
+	
+	detach(timer);
+	timer->expires = now + delay;
+	timer->period = period;
+	insert(timer);
+}
+
+/*
+ * @see timerwheel.h
+ */
+void timer_stop(struct timer * timer) {
+	detach(timer);
+}
+
+/*
+ * @see timerwheel.h
+ */
+bool timer_isActive(struct timer * timer) {
+	return timer->state != STATE_IDLE;
+}
+
+/*
+ * @see timerwheel.h
+ */
+void timer_dispatch() {
+	uint32_t now = systick_millis();
+	
+	if (!started) {
+		return;
+	}
+	
+	// Every slot is scanned once if we're late by a full turn
+	if (now - lastTick > TIMER_WHEEL_SLOTS) {
+		lastTick = now - TIMER_WHEEL_SLOTS;
+	}
+	
+	// Move the expired timers of the elapsed slots to the due list
+	while (lastTick != now) {
+		lastTick++;
+		struct timer ** link = &wheel[lastTick & SLOT_MASK];
+		while (*link != NULL) {
+			struct timer * timer = *link;
+			if (isExpired(timer->expires, now)) {
+				*link = timer->next;
+				timer->next = dueList;
+				dueList = timer;
+				timer->state = STATE_DUE;
+			} else {
+				link = &timer->next;
+			}
+		}
+	}
+	
+	// Callbacks are free to start or stop any timer, including due ones
+	while (dueList != NULL) {
+		struct timer * timer = dueList;
+		dueList = timer->next;
+		timer->state = STATE_IDLE;
+		
+		if (timer->period != 0) {
+			timer->expires += timer->period;
+			if (isExpired(timer->expires, now)) {
+				timer->expires = now + timer->period;
+			}
+			insert(timer);
+		}
+		timer->callback(timer->arg);
+	}
+}
@@ -0,0 +1,120 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <util/atomic.h>
+#include "trace.h"
+#include "systick.h"
+
+#if TRACE_SIZE * 4 + 8 > 255
+#error TRACE_SIZE too large to be read in a single SPI block
+#endif
+
+static struct trace_dump dump;
+static uint8_t mask = TRACE_MASK_DEFAULT;
+static uint8_t triggerId = 0;
+static uint8_t triggerAfter = 0;
+static uint8_t triggerRemaining;
+static bool triggered = false;
+static bool recorded = false;
+
+/**
+ * Freezes with interrupts disabled.
+ */
+static inline void freeze() {
+	dump.flags |= TRACE_FLAG_FROZEN;
+	dump.anchorMillis = systick_millis();
+	dump.anchorTime = systick_stamp();
+}
+
+/*
+ * @see trace.h
+ */
+void trace(uint8_t id, uint8_t arg) {
+	if (!(mask & (1 << TRACE_GROUP(id)))) {
+		return;
+	}
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if (!(dump.flags & TRACE_FLAG_FROZEN)) {
+			struct trace_record * record = &dump.records[dump.head];
+			
+			record->time = systick_stamp();
+			record->id = id;
+			record->arg = arg;
+			if (++dump.head == TRACE_SIZE) {
+				dump.head = 0;
+				dump.flags |= TRACE_FLAG_WRAPPED;
+			}
+			recorded = true;
+			
+			if (triggered) {
+				if (--triggerRemaining == 0) {
+					freeze();
+				}
+			} else if (id == triggerId) {
+				triggered = true;
+				triggerRemaining = triggerAfter;
+				if (triggerRemaining == 0) {
+					freeze();
+				}
+			}
+		}
+	}
+}
+
+/*
+ * @see trace.h
+ */
+void trace_tick() {
+	if (!recorded) {
+		trace(TRACE_TICK, 0);
+	}
+	recorded = false;
+}
+
+/*
+ * @see trace.h
+ */
+void trace_freeze() {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if (!(dump.flags & TRACE_FLAG_FROZEN)) {
+			freeze();
+		}
+	}
+}
+
+/*
+ * @see trace.h
+ */
+void trace_resume() {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		dump.head = 0;
+		dump.flags = 0;
+		triggered = false;
+	}
+}
+
+/*
+ * @see trace.h
+ */
+void trace_setTrigger(uint8_t id, uint8_t after) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		triggerId = id;
+		triggerAfter = after;
+		triggered = false;
+	}
+}
+
+/*
+ * @see trace.h
+ */
+void trace_setMask(uint8_t groups) {
+	mask = groups;
+}
+
+/*
+ * @see trace.h
+ */
+const struct trace_dump * trace_get() {
+	trace_freeze();
+	return &dump;
+}
@@ -4,6 +4,8 @@
 #include <util/atomic.h>
 #include "uart.h"
 #include "defineConfig.h"
+#include "event.h"
+#include "isrprof.h"
 
 #define BAUDRATE_REG_MAX 4095 // 12 bits register (2^12 - 1)
 #define BAUDRATE_VALUE_MAX ((F_CPU)/16)
@@ -28,7 +30,7 @@ static volatile size_t txBufferTail = 0;
 static volatile size_t rxBufferHead = 0;
 static volatile size_t rxBufferTail = 0;
 
-static volatile bool rxOverflow = false;
+static volatile uint16_t rxOverruns = 0;
 
 FILE uartStream = FDEV_SETUP_STREAM(uart_write, NULL, _FDEV_SETUP_WRITE);
 
@@ -107,10 +109,23 @@ int uart_read() {
 	}
 }
 
+/*
+ * @see uart.h
+ */
+uint16_t uart_getOverruns() {
+	uint16_t value;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		value = rxOverruns;
+	}
+	return value;
+}
+
 /**
  * USART Rx Complete Interrupt handler, receives the next byte into the Rx buffer.
  */
 ISR(USART_RX_vect) {
+	ISR_PROFILE_ENTER();
 	// We know there is something in the rx buffer, read it
 	char c = UDR0;
 	size_t i = (rxBufferHead + 1) % UART_RX_BUFFER_SIZE;
@@ -120,8 +135,14 @@ ISR(USART_RX_vect) {
 		rxBuffer[rxBufferHead] = c;
 		rxBufferHead = i;
 	} else {
-		rxOverflow = true;
+		rxOverruns++;
+	}
+
+	// Wake up the reader for a complete line, or before the buffer is full
+	if (c == '\n' || (rxBufferHead + UART_RX_BUFFER_SIZE - rxBufferTail) % UART_RX_BUFFER_SIZE >= UART_RX_BUFFER_SIZE / 2) {
+		event_post(EVENT_UART);
 	}
+	ISR_PROFILE_EXIT(ISRPROF_USART_RX);
 }
 
 /**
@@ -130,6 +151,7 @@ ISR(USART_RX_vect) {
  * 	This interrupt is managed to only be enabled when the tx buffer has data.
  */
 ISR(USART_UDRE_vect) {
+	ISR_PROFILE_ENTER();
 	char c = txBuffer[txBufferTail];
 	txBufferTail = (txBufferTail + 1) % UART_TX_BUFFER_SIZE;
 	UDR0 = c;
@@ -138,4 +160,5 @@ ISR(USART_UDRE_vect) {
 	if (txBufferTail == txBufferHead) {
 		UCSR0B &= ~_BV(UDRIE0);
 	}
+	ISR_PROFILE_EXIT(ISRPROF_USART_UDRE);
 }
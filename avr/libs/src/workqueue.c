@@ -0,0 +1,67 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <util/atomic.h>
+#include "workqueue.h"
+#include "event.h"
+
+struct workItem {
+	void (*work)(void *);
+	void * arg;
+};
+
+static struct workItem queue[WORK_QUEUE_SIZE];
+static volatile uint8_t head = 0;
+static volatile uint8_t tail = 0;
+static volatile uint16_t dropped = 0;
+
+/*
+ * @see workqueue.h
+ */
+bool workqueue_post(void (*work)(void *), void * arg) {
+	bool queued = false;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		uint8_t next = (head + 1) % WORK_QUEUE_SIZE;
+		if (next != tail) {
+			queue[head].work = work;
+			queue[head].arg = arg;
+			head = next;
+			queued = true;
+		} else {
+			dropped++;
+		}
+	}
+	
+	if (queued) {
+		event_post(EVENT_WORK);
+	}
+	return queued;
+}
+
+/*
+ * @see workqueue.h
+ */
+void workqueue_run() {
+	struct workItem item;
+	
+	while (tail != head) {
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+			item = queue[tail];
+			tail = (tail + 1) % WORK_QUEUE_SIZE;
+		}
+		item.work(item.arg);
+	}
+}
+
+/*
+ * @see workqueue.h
+ */
+uint16_t workqueue_getDropped() {
+	uint16_t value;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		value = dropped;
+	}
+	return value;
+}
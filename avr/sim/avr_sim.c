@@ -0,0 +1,671 @@
+/*
+ * Runs the unmodified firmware in simavr with a model of the board
+ * around it and reports the timings of the links.
+ *
+ * The harness plays:
+ * 		- The BBB, a SPI master that shifts the commands and the blocks
+ * 		  of spi_command.h one byte at a time like bbb/avr_diag.py, and
+ * 		  watches the status line.
+ * 		- The reed switch of the lid on BOX_SWITCH_IO, opened and closed
+ * 		  on a fixed schedule after the open and close commands.
+ * 		- The LSM303 accelerometer, an I2C responder with the register
+ * 		  map of lsm303.c that reads a box at rest.
+ * 		- The serial terminal, the console output is captured and
+ * 		  commands are typed at the baud rate.
+ *
+ * Every time is counted in CPU cycles of the simulation, the numbers
+ * don't depend on the host and are compared between two builds. The
+ * exit status is 1 if a byte was dropped or an answer was wrong.
+ *
+ * Usage:
+ * 		make sim
+ * 		bin/sim/avr_sim bin/avr.elf [-v]
+ *
+ * -v prints the console output.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "sim_io.h"
+#include "sim_irq.h"
+#include "sim_cycle_timers.h"
+#include "avr_ioport.h"
+#include "avr_spi.h"
+#include "avr_twi.h"
+#include "avr_uart.h"
+#include "spi_command.h"
+#include "health.h"
+
+#define SIM_MCU			"atmega328p"
+#define SIM_FREQUENCY	(16000000)
+
+// Data space addresses of the ATmega328P
+#define ADDR_DDRD		(0x2A)
+#define ADDR_SPDR		(0x4E)
+
+// Pins of pin_config.h
+#define STATUS_BIT		(5)		// BBB_STATUS_IO, PD5
+#define SWITCH_PORT		('C')	// BOX_SWITCH_IO, PC3
+#define SWITCH_BIT		(3)
+
+// Commands of spi_command.c
+#define CMD_UNLOCK_OPEN		(0xA1)
+#define CMD_LOCK_CLOSE		(0xA2)
+#define CMD_CHECK_STATUS	(0xA3)
+#define CMD_GET_STATUS		(0xC1)
+
+#define HEALTH_SIZE		(offsetof(struct health_block, version) + 1)
+
+// struct isrprof_stats of isrprof.h, little endian
+#define ISRPROF_SIZE	(12)
+
+// Delay between two bytes of the master, as byteDelay of avr_diag.py
+#define BYTE_DELAY_US	(500)
+
+// One character at 9600 baud and some margin
+#define CHAR_DELAY_US	(1100)
+
+// Servo frame, ICR1 of servo.c with the prescaler of 8
+#define SERVO_FRAME_CYCLES	(40000UL * 8)
+
+// Script of the scenario
+#define BOOT_TIMEOUT_MS		(5000)
+#define ROUND_TRIPS			(20)
+#define ROUND_TRIP_TIMEOUT_MS	(100)
+#define SWITCH_OPEN_MS		(500)	// Open command to the lid off the magnet
+#define LID_TRAVEL_MS		(3000)	// Lid from one end to the other
+#define LOCK_TRAVEL_MS		(1500)
+#define CONSOLE_LINES		(16)
+
+#define CONSOLE_CAPTURE_SIZE	(64 * 1024)
+
+struct latency {
+	uint32_t count;
+	uint64_t total;
+	uint32_t min;
+	uint32_t max;
+};
+
+struct pulses {
+	const char * name;
+	avr_cycle_count_t rise;
+	uint32_t count;
+	uint32_t widthMin;
+	uint32_t widthMax;
+	uint32_t periodMin;
+	uint32_t periodMax;
+};
+
+static const char * const isrVectors[] = {
+	"TIMER0_COMPA", "TIMER1_CAPT", "TIMER1_COMPA", "SPI_STC", "USART_RX",
+	"USART_UDRE", "TWI", "INT0", "ACCEL_INT2", "BOX_SWITCH",
+};
+
+static avr_t * avr;
+static bool verbose;
+static int failures;
+
+// BBB
+static avr_irq_t * spiIn;
+static uint8_t miso;
+static uint32_t masterBytes;
+static avr_cycle_count_t mosiCycle;
+static bool spdrLoaded;
+static avr_cycle_count_t spdrCycle;
+static bool statusLow;
+static avr_cycle_count_t statusCycle;
+static struct latency spiAnswer;
+static struct latency roundTrip;
+
+// Lid
+static avr_irq_t * switchIrq;
+static struct pulses lidPulses = {"lid (PB1)"};
+static struct pulses lockPulses = {"lock (PC0)"};
+
+// LSM303
+#define LSM303_ADDRESS		(0x32)	// LSM303DLHC_ADDRESS_LIN_ACCEL
+#define LSM303_AUTO_INC		(0x80)
+#define LSM303_STATUS_REG	(0x27)
+#define LSM303_OUT_Z_H		(0x2D)
+
+static avr_irq_t * twiIn;
+static uint8_t lsm303Regs[0x80];
+static uint8_t lsm303Selected;
+static bool lsm303HasReg;
+static uint8_t lsm303Reg;
+static uint32_t i2cTransactions;
+
+// Terminal
+static avr_irq_t * uartIn;
+static char console[CONSOLE_CAPTURE_SIZE];
+static size_t consoleLength;
+static bool consoleLineStart = true;
+
+/**
+ * Records a failure of the run.
+ */
+static void fail(const char * what, unsigned expected, unsigned got) {
+	printf("FAIL %s: expected 0x%02X, got 0x%02X\n", what, expected, got);
+	failures++;
+}
+
+static void latencyAdd(struct latency * l, uint32_t cycles) {
+	if (l->count == 0 || cycles < l->min) {
+		l->min = cycles;
+	}
+	if (cycles > l->max) {
+		l->max = cycles;
+	}
+	l->count++;
+	l->total += cycles;
+}
+
+static void latencyPrint(const char * name, const struct latency * l) {
+	if (l->count == 0) {
+		printf("%-16s none\n", name);
+		return;
+	}
+	printf("%-16s %6u x  min %6u  avg %6u  max %6u cycles\n", name, l->count, l->min,
+			(uint32_t) (l->total / l->count), l->max);
+}
+
+static avr_cycle_count_t usToCycles(uint32_t us) {
+	return (avr_cycle_count_t) us * (SIM_FREQUENCY / 1000000);
+}
+
+static avr_cycle_count_t wake(avr_t * avr, avr_cycle_count_t when, void * param) {
+	return 0;
+}
+
+/**
+ * Runs the firmware for a time, the timer wakes the core if it sleeps
+ * until then.
+ */
+static void runFor(uint32_t us) {
+	avr_cycle_count_t end = avr->cycle + usToCycles(us);
+
+	avr_cycle_timer_register(avr, usToCycles(us), wake, NULL);
+	while (avr->cycle < end) {
+		int state = avr_run(avr);
+		if (state == cpu_Done || state == cpu_Crashed) {
+			printf("FAIL the core stopped at cycle %llu\n", (unsigned long long) avr->cycle);
+			exit(2);
+		}
+	}
+}
+
+/**
+ * Byte shifted out by the AVR, raised when the master shifts a byte in.
+ */
+static void spiOutput(avr_irq_t * irq, uint32_t value, void * param) {
+	miso = value;
+}
+
+/**
+ * Write of SPDR by the firmware, the first one after a byte of the
+ * master is the answer of the SPI interrupt.
+ */
+static void spdrWrite(avr_irq_t * irq, uint32_t value, void * param) {
+	if (!spdrLoaded) {
+		spdrLoaded = true;
+		spdrCycle = avr->cycle;
+	}
+}
+
+/**
+ * Write of DDRD, the status line is pulled low when BBB_STATUS_IO is an
+ * output.
+ */
+static void ddrdWrite(avr_irq_t * irq, uint32_t value, void * param) {
+	bool low = value & (1 << STATUS_BIT);
+
+	if (low && !statusLow) {
+		statusCycle = avr->cycle;
+	}
+	statusLow = low;
+}
+
+/**
+ * One byte shifted by the BBB, then the byte delay.
+ *
+ * @param mosi Byte sent by the master
+ * @return Byte received by the master, loaded by the previous interrupt
+ */
+static uint8_t transfer(uint8_t mosi) {
+	masterBytes++;
+	spdrLoaded = false;
+	mosiCycle = avr->cycle;
+	avr_raise_irq(spiIn, mosi);
+	runFor(BYTE_DELAY_US);
+
+	if (spdrLoaded) {
+		latencyAdd(&spiAnswer, spdrCycle - mosiCycle);
+	}
+	return miso;
+}
+
+/**
+ * Reads a block: the command, the size, one byte per transfer, then the
+ * dummy that brings the AVR back to wait for a command.
+ *
+ * @return Size of the block
+ */
+static uint8_t readBlock(uint8_t cmd, uint8_t * data) {
+	transfer(cmd);
+	uint8_t size = transfer(0);
+	for (uint8_t i = 0; i < size; i++) {
+		data[i] = transfer(0);
+	}
+	transfer(0);
+	return size;
+}
+
+static bool readHealth(struct health_block * health) {
+	uint8_t data[UINT8_MAX];
+
+	if (readBlock(SPICMD_BLOCK_HEALTH, data) != HEALTH_SIZE) {
+		return false;
+	}
+	memcpy(health, data, HEALTH_SIZE);
+	return health->version == HEALTH_VERSION;
+}
+
+/**
+ * Sends a command and checks the ACK.
+ *
+ * @return The cycle of the command byte
+ */
+static avr_cycle_count_t sendCommand(uint8_t cmd) {
+	transfer(cmd);
+	avr_cycle_count_t sent = mosiCycle;
+
+	uint8_t ack = transfer(0);
+	if (ack != SPICMD_ACK) {
+		fail("command ACK", SPICMD_ACK, ack);
+	}
+	return sent;
+}
+
+/**
+ * Waits for the status line, then shifts the queued byte out.
+ *
+ * @return The byte, SPICMD_NACK if the line stayed up
+ */
+static uint8_t getStatus(uint32_t timeoutMs) {
+	for (uint32_t waited = 0; !statusLow && waited < timeoutMs * 10; waited++) {
+		runFor(100);
+	}
+	if (!statusLow) {
+		return SPICMD_NACK;
+	}
+	transfer(CMD_GET_STATUS);
+	return transfer(0);
+}
+
+/**
+ * Round trip of a command through the SPI interrupt, the main loop and
+ * the box state machine, to the status line.
+ */
+static void checkStatus(uint8_t expected) {
+	avr_cycle_count_t sent = sendCommand(CMD_CHECK_STATUS);
+	uint8_t status = getStatus(ROUND_TRIP_TIMEOUT_MS);
+
+	if (status == SPICMD_NACK) {
+		fail("status line", expected, status);
+		return;
+	}
+	latencyAdd(&roundTrip, statusCycle - sent);
+	if (status != expected) {
+		fail("box status", expected, status);
+	}
+}
+
+/**
+ * Drops the commands queued to the BBB, none is expected at rest.
+ */
+static void drainStatus(void) {
+	while (statusLow) {
+		uint8_t queued = getStatus(0);
+		printf("%-16s 0x%02X\n", "queued", queued);
+		if (queued == SPICMD_BBB_BOX_FAULT) {
+			fail("box", SPICMD_RESP_CLOSED, queued);
+		}
+	}
+}
+
+static void setSwitch(bool open) {
+	avr_raise_irq(switchIrq, open);
+}
+
+/**
+ * Level change of a servo output.
+ */
+static void servoEdge(avr_irq_t * irq, uint32_t value, void * param) {
+	struct pulses * p = param;
+
+	if (value) {
+		uint32_t period = avr->cycle - p->rise;
+
+		// The first pulse after a stop starts a new train
+		if (p->rise != 0 && period < SERVO_FRAME_CYCLES + SERVO_FRAME_CYCLES / 2) {
+			if (p->periodMax == 0 || period < p->periodMin) {
+				p->periodMin = period;
+			}
+			if (period > p->periodMax) {
+				p->periodMax = period;
+			}
+		}
+		p->rise = avr->cycle;
+	} else if (p->rise != 0) {
+		uint32_t width = avr->cycle - p->rise;
+
+		if (p->count == 0 || width < p->widthMin) {
+			p->widthMin = width;
+		}
+		if (width > p->widthMax) {
+			p->widthMax = width;
+		}
+		p->count++;
+	}
+}
+
+static void pulsesPrint(const struct pulses * p) {
+	if (p->count == 0) {
+		printf("%-16s no pulse\n", p->name);
+		return;
+	}
+	printf("%-16s %6u x  width %6u..%-6u period %6u..%-6u jitter %u cycles\n", p->name, p->count,
+			p->widthMin, p->widthMax, p->periodMin, p->periodMax, p->periodMax - p->periodMin);
+}
+
+/**
+ * Message of the TWI master, the LSM303 answers its address like the
+ * i2c_eeprom part of simavr. The first byte written is the register,
+ * then the register auto-increments.
+ */
+static void twiOutput(avr_irq_t * irq, uint32_t value, void * param) {
+	avr_twi_msg_irq_t v;
+	v.u.v = value;
+
+	if (v.u.twi.msg & TWI_COND_STOP) {
+		lsm303Selected = 0;
+	}
+	if (v.u.twi.msg & TWI_COND_START) {
+		lsm303Selected = 0;
+		if ((v.u.twi.addr & 0xFE) == LSM303_ADDRESS) {
+			lsm303Selected = v.u.twi.addr;
+			i2cTransactions++;
+			// A write starts with the register, a repeated start reads it
+			lsm303HasReg = v.u.twi.addr & 0x01;
+			avr_raise_irq(twiIn, avr_twi_irq_msg(TWI_COND_ACK, lsm303Selected, 1));
+		}
+	}
+	if (!lsm303Selected) {
+		return;
+	}
+	if (v.u.twi.msg & TWI_COND_WRITE) {
+		avr_raise_irq(twiIn, avr_twi_irq_msg(TWI_COND_ACK, lsm303Selected, 1));
+		if (!lsm303HasReg) {
+			lsm303Reg = v.u.twi.data & ~LSM303_AUTO_INC;
+			lsm303HasReg = true;
+		} else {
+			// The status register is read only
+			if (lsm303Reg != LSM303_STATUS_REG) {
+				lsm303Regs[lsm303Reg] = v.u.twi.data;
+			}
+			lsm303Reg = (lsm303Reg + 1) & 0x7F;
+		}
+	}
+	if (v.u.twi.msg & TWI_COND_READ) {
+		avr_raise_irq(twiIn, avr_twi_irq_msg(TWI_COND_READ, lsm303Selected, lsm303Regs[lsm303Reg]));
+		lsm303Reg = (lsm303Reg + 1) & 0x7F;
+	}
+}
+
+/**
+ * Byte sent on the console.
+ */
+static void uartOutput(avr_irq_t * irq, uint32_t value, void * param) {
+	if (consoleLength < CONSOLE_CAPTURE_SIZE - 1) {
+		console[consoleLength++] = value;
+	}
+	if (verbose) {
+		if (consoleLineStart) {
+			fputs("uart> ", stdout);
+		}
+		putchar(value);
+		consoleLineStart = (value == '\n');
+	}
+}
+
+/**
+ * Types a line on the console at the baud rate.
+ */
+static void typeLine(const char * line) {
+	for (; *line; line++) {
+		avr_raise_irq(uartIn, (uint8_t) *line);
+		runFor(CHAR_DELAY_US);
+	}
+	avr_raise_irq(uartIn, '\n');
+	runFor(CHAR_DELAY_US);
+}
+
+static size_t countLines(const char * from, const char * prefix) {
+	size_t count = 0;
+
+	console[consoleLength] = '\0';
+	for (const char * s = strstr(from, prefix); s; s = strstr(s + 1, prefix)) {
+		count++;
+	}
+	return count;
+}
+
+static avr_irq_t * pinIrq(char port, int bit) {
+	return avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(port), bit);
+}
+
+/**
+ * Loads the firmware and wires the models to the peripherals.
+ */
+static void setup(const char * path) {
+	elf_firmware_t firmware;
+
+	memset(&firmware, 0, sizeof(firmware));
+	if (elf_read_firmware(path, &firmware) != 0) {
+		fprintf(stderr, "Cannot read %s\n", path);
+		exit(2);
+	}
+
+	avr = avr_make_mcu_by_name(SIM_MCU);
+	if (avr == NULL) {
+		fprintf(stderr, "simavr has no %s\n", SIM_MCU);
+		exit(2);
+	}
+	avr_init(avr);
+	firmware.frequency = SIM_FREQUENCY;
+	avr_load_firmware(avr, &firmware);
+
+	spiIn = avr_io_getirq(avr, AVR_IOCTL_SPI_GETIRQ(0), SPI_IRQ_INPUT);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_SPI_GETIRQ(0), SPI_IRQ_OUTPUT), spiOutput, NULL);
+	avr_irq_register_notify(avr_iomem_getirq(avr, ADDR_SPDR, NULL, AVR_IOMEM_IRQ_ALL), spdrWrite, NULL);
+	avr_irq_register_notify(avr_iomem_getirq(avr, ADDR_DDRD, NULL, AVR_IOMEM_IRQ_ALL), ddrdWrite, NULL);
+
+	switchIrq = pinIrq(SWITCH_PORT, SWITCH_BIT);
+	avr_irq_register_notify(pinIrq('B', 1), servoEdge, &lidPulses);
+	avr_irq_register_notify(pinIrq('C', 0), servoEdge, &lockPulses);
+
+	// A box at rest: 1 g on Z in the left-aligned output, data ready
+	lsm303Regs[LSM303_STATUS_REG] = 0x0F;
+	lsm303Regs[LSM303_OUT_Z_H] = 0x40;
+	twiIn = avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_INPUT);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_OUTPUT), twiOutput, NULL);
+
+	// No echo of simavr on stdout and no host sleep while the firmware polls
+	uint32_t flags = 0;
+	avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+	flags &= ~(AVR_UART_FLAG_STDIO | AVR_UART_FLAG_POOL_SLEEP);
+	avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+	uartIn = avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_INPUT);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT), uartOutput, NULL);
+}
+
+/**
+ * Polls the health block until the box and the alert are ready.
+ */
+static void boot(void) {
+	struct health_block health;
+	bool ready = false;
+
+	memset(&health, 0, sizeof(health));
+
+	for (uint32_t ms = 0; !ready && ms < BOOT_TIMEOUT_MS; ms += 50) {
+		runFor(50000);
+		ready = readHealth(&health)
+				&& (health.ready & (HEALTH_READY_BOX | HEALTH_READY_ALERT)) == (HEALTH_READY_BOX | HEALTH_READY_ALERT);
+	}
+	if (!ready) {
+		fail("ready", HEALTH_READY_BOX | HEALTH_READY_ALERT, health.ready);
+		return;
+	}
+	printf("%-16s link up %u ms, first SPI %u ms, ready %llu ms\n", "boot", health.linkUpMs,
+			health.firstSpiMs, (unsigned long long) (avr->cycle / usToCycles(1000)));
+}
+
+/**
+ * Opens then closes the box, the reed switch follows the lid.
+ */
+static void openAndClose(void) {
+	sendCommand(CMD_UNLOCK_OPEN);
+	runFor(SWITCH_OPEN_MS * 1000UL);
+	setSwitch(true);
+	runFor(LID_TRAVEL_MS * 1000UL);
+	drainStatus();
+	checkStatus(SPICMD_RESP_OPENED);
+
+	sendCommand(CMD_LOCK_CLOSE);
+	runFor(LID_TRAVEL_MS * 1000UL);
+	setSwitch(false);
+	runFor(LOCK_TRAVEL_MS * 1000UL);
+	drainStatus();
+	checkStatus(SPICMD_RESP_CLOSED);
+}
+
+/**
+ * Types lines back to back, every one must be answered.
+ */
+static void consoleBurst(void) {
+	if (consoleLength == 0) {
+		printf("%-16s none\n", "console");
+		return;
+	}
+
+	size_t start = consoleLength;
+	avr_cycle_count_t begin = avr->cycle;
+	char line[32];
+	for (int i = 0; i < CONSOLE_LINES; i++) {
+		snprintf(line, sizeof(line), "CMD -ping %d", i);
+		typeLine(line);
+	}
+	runFor(100000);
+
+	size_t pongs = countLines(console + start, "Pong! ");
+	printf("%-16s %u lines in %llu cycles, %u answered\n", "console", CONSOLE_LINES,
+			(unsigned long long) (avr->cycle - begin), (unsigned) pongs);
+	if (pongs != CONSOLE_LINES) {
+		fail("console answers", CONSOLE_LINES, pongs);
+	}
+}
+
+/**
+ * Bytes seen by the firmware against the bytes shifted, and the drop
+ * counters of the health block.
+ */
+static void checkDrops(void) {
+	struct health_block health;
+
+	// The counters are published once per period
+	runFor((HEALTH_PERIOD_MS + 100) * 1000UL);
+	uint32_t shifted = masterBytes;
+	if (!readHealth(&health)) {
+		fail("health block", HEALTH_SIZE, 0);
+		return;
+	}
+
+	printf("%-16s %u shifted, %u seen by the AVR\n", "spi bytes", shifted, health.spiBytes);
+	printf("%-16s desyncs %u, queue full %u, work dropped %u, uart overruns %u, i2c errors %u\n",
+			"drops", health.spiDesyncs, health.spiQueueFull, health.workDropped,
+			health.uartOverruns, health.i2cErrors);
+	printf("%-16s %u transactions\n", "i2c", i2cTransactions);
+	printf("%-16s %u bytes unused\n", "stack", health.stackUnused);
+
+	if (health.spiBytes != shifted) {
+		fail("spi bytes", shifted, health.spiBytes);
+	}
+	if (health.spiDesyncs || health.spiQueueFull || health.workDropped
+			|| health.uartOverruns || health.i2cErrors) {
+		fail("drop counters", 0, 1);
+	}
+}
+
+/**
+ * Cycles of the interrupt handlers measured by the firmware itself.
+ */
+static void printIsrProfile(void) {
+	uint8_t data[UINT8_MAX];
+	uint8_t size = readBlock(SPICMD_BLOCK_ISR_PROFILE, data);
+
+	if (size == 0) {
+		printf("%-16s build with DEFS=-DISR_PROFILE\n", "isr");
+		return;
+	}
+	for (uint8_t i = 0; i + ISRPROF_SIZE <= size; i += ISRPROF_SIZE) {
+		uint32_t count, total;
+		uint16_t min, max;
+		memcpy(&count, data + i, 4);
+		memcpy(&total, data + i + 4, 4);
+		memcpy(&min, data + i + 8, 2);
+		memcpy(&max, data + i + 10, 2);
+
+		uint8_t vector = i / ISRPROF_SIZE;
+		printf("isr %-12s %6u x  min %6u  avg %6u  max %6u cycles\n",
+				vector < sizeof(isrVectors) / sizeof(isrVectors[0]) ? isrVectors[vector] : "?",
+				count, min, count ? total / count : 0, max);
+	}
+}
+
+int main(int argc, char * argv[]) {
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s avr.elf [-v]\n", argv[0]);
+		return 2;
+	}
+	verbose = (argc > 2 && strcmp(argv[2], "-v") == 0);
+
+	setup(argv[1]);
+
+	// Lid closed at power on
+	setSwitch(false);
+	boot();
+	drainStatus();
+
+	for (int i = 0; i < ROUND_TRIPS; i++) {
+		checkStatus(SPICMD_RESP_CLOSED);
+	}
+	openAndClose();
+	consoleBurst();
+	checkDrops();
+
+	latencyPrint("spi answer", &spiAnswer);
+	latencyPrint("round trip", &roundTrip);
+	pulsesPrint(&lidPulses);
+	pulsesPrint(&lockPulses);
+	printIsrProfile();
+
+	printf("%s\n", failures ? "FAILED" : "PASSED");
+	return failures ? 1 : 0;
+}
@@ -1,28 +1,73 @@
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 #include <avr/io.h>
 #include <avr/sfr_defs.h>
-#include <util/delay.h>
 #include <avr/interrupt.h>
 #include <util/atomic.h>
 #include "spi_command.h"
 #include "alert.h"
 #include "lsm303.h"
+#include "vibration.h"
+#include "orientation.h"
+#include "calibration.h"
 #include "pin_config.h"
 #include "ioctl.h"
+#include "timerwheel.h"
+#include "workqueue.h"
+#include "isrprof.h"
 
 #define ALERT_STATE_OFF			(0)
 #define ALERT_STATE_OK			(1)
 #define ALERT_STATE_ARMED 		(ALERT_RUN_ARMED)
 #define ALERT_STATE_INTRUDER 	(3)
 #define ALERT_STATE_DISARMED	(ALERT_RUN_DISARM)
+#define ALERT_STATE_CLASSIFYING	(4)
 
 static void wait();
+static void quietPeriodEnd(void * arg);
+static void processSample();
+static void processEngineEvent();
+static void sampleTick(void * arg);
+static void calibrationTick(void * arg);
 
 typedef uint8_t State;
 volatile State alarmState = ALERT_STATE_OFF;
 
-volatile int timerCount = 0;
+static struct timer quietTimer;
+static struct timer sampleTimer;
+static struct timer settleTimer;
+static struct timer calibrationTimer;
+
+static volatile bool engineEventPending = false;
+
+#define PROFILE_NONE (0xFF)
+
+struct accelProfile {
+	enum lsm303_data_rate rate;
+	enum lsm303_power_mode mode;
+	uint8_t samplePeriod;
+};
+
+static const struct accelProfile profiles[] = {
+	[ALERT_PROFILE_DISARMED] = {ALERT_DISARMED_DATA_RATE, LSM303_MODE_LOW_POWER, 0},
+	[ALERT_PROFILE_ARMED] = {ALERT_ARMED_DATA_RATE, LSM303_MODE_HIGH_RESOLUTION, ALERT_ARMED_SAMPLE_MS},
+	[ALERT_PROFILE_FORENSIC] = {ALERT_FORENSIC_DATA_RATE, LSM303_MODE_HIGH_RESOLUTION, ALERT_FORENSIC_SAMPLE_MS}
+};
+
+static uint8_t currentProfile = PROFILE_NONE;
+static uint8_t currentRun = ALERT_RUN_DISARM;
+
+static struct calibration_result calibration = {
+	.threshold = ALERT_ACCEL_THRESHOLD,
+	.duration = ALERT_ACCEL_DURATION,
+	.flags = CALIBRATION_FLAG_DEFAULTS
+};
+static bool calibrating = false;
+static int calibrationStatus = CALIBRATION_OK;
+
+static struct vibration_features lastFeatures;
+static enum vibration_class lastClass = VIBRATION_CLASS_NONE;
 
 
 /**
@@ -34,12 +79,18 @@ volatile int timerCount = 0;
 static inline void armAlert() {
 	lsm303_clear_latched_interrupt();
 
-	// Enable interrupt 0 
+	lsm303_clear_orientation_interrupt();
+	lsm303_clear_click();
+
+	// Enable interrupt 0 and the INT2 pin change
 	EIMSK |= _BV(INT0);
+	ACCEL_INT2_PCMSK |= _BV(ACCEL_INT2_PCINT);
 	
 	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		engineEventPending = false;
 		alarmState = ALERT_STATE_ARMED;
 	}
+	trace(TRACE_ALERT_STATE, ALERT_STATE_ARMED);
 }
 
 /**
@@ -49,11 +100,24 @@ static inline void armAlert() {
  * This does not change the state machine. 
  */
 static inline void disableAlertInterrupt() {
-	// Disable interrupt 0 
+	// Disable interrupt 0 and the INT2 pin change
 	EIMSK &= ~_BV(INT0);
+	ACCEL_INT2_PCMSK &= ~_BV(ACCEL_INT2_PCINT);
 	lsm303_clear_latched_interrupt();
 }
 
+/**
+ * Starts a vibration classification window, the EXTINT0 is disabled 
+ * until the window is classified.
+ */
+static inline void startClassification() {
+	EIMSK &= ~_BV(INT0);
+	lsm303_clear_latched_interrupt();
+	vibration_reset();
+	alarmState = ALERT_STATE_CLASSIFYING;
+	trace(TRACE_ALERT_STATE, ALERT_STATE_CLASSIFYING);
+}
+
 /**
  * Set the alert to DISARMED.
  * 
@@ -64,6 +128,19 @@ static inline void disarmAlert() {
 	ATOMIC_BLOCK(ATOMIC_FORCEON) {
 		alarmState = ALERT_STATE_DISARMED;
 	}
+	trace(TRACE_ALERT_STATE, ALERT_STATE_DISARMED);
+}
+
+/**
+ * Raise the intruder alert to the BBB and start the quiet period.
+ */
+static inline void raiseIntruderAlert() {
+	disableAlertInterrupt();
+	spicmd_send(SPICMD_BBB_ALERT);
+	ioctl_write(&LED_ALIVE_PORT, LED_ALIVE_IO, 1);
+	alarmState = ALERT_STATE_INTRUDER;
+	trace(TRACE_ALERT_STATE, ALERT_STATE_INTRUDER);
+	wait();
 }
 
 /*
@@ -73,84 +150,343 @@ uint8_t alert_getstatus() {
 	return alarmState;
 }
 
+/*
+ * @see alert.h
+ */
+uint8_t alert_getLastClass(struct vibration_features * features) {
+	if (features != NULL) {
+		*features = lastFeatures;
+	}
+	return lastClass;
+}
+
+/*
+ * @see alert.h
+ */
+uint8_t alert_getProfile() {
+	return currentProfile;
+}
+
+/**
+ * Switches the accelerometer to the profile needed by the requested run
+ * status and the current state. 
+ * 
+ * The LSM303 is only reconfigured when the profile changes.
+ * 
+ * @param run ALERT_RUN_ARMED/ALERT_RUN_DISARM
+ */
+static void updateProfile(uint8_t run) {
+	uint8_t profile;
+	
+	if (run == ALERT_RUN_DISARM) {
+		profile = ALERT_PROFILE_DISARMED;
+	} else if (alarmState == ALERT_STATE_CLASSIFYING) {
+		profile = ALERT_PROFILE_FORENSIC;
+	} else {
+		profile = ALERT_PROFILE_ARMED;
+	}
+	
+	if (profile != currentProfile) {
+		lsm303_set_mode(profiles[profile].rate, ALERT_ACCEL_SCALE, profiles[profile].mode);
+		currentProfile = profile;
+		
+		if (profiles[profile].samplePeriod != 0) {
+			timer_start(&sampleTimer, profiles[profile].samplePeriod, profiles[profile].samplePeriod);
+		} else {
+			timer_stop(&sampleTimer);
+		}
+	}
+}
+
 /*
  * @see alert.h
  */
 void alert_run(uint8_t run) {
+	currentRun = run;
+	if (alarmState == ALERT_STATE_OFF || calibrating) {
+		return;
+	}
+	updateProfile(run);
+	
 	if ((alarmState == ALERT_STATE_DISARMED || alarmState == ALERT_STATE_OK) && run == ALERT_RUN_ARMED) {
+		// Reference orientation is captured on the first armed sample
+		orientation_reset();
 		armAlert();
 		alarmState = run;
 	} else if (alarmState == ALERT_STATE_ARMED && run == ALERT_RUN_DISARM) {
 		disarmAlert();
 		alarmState = run;
+	} else if (alarmState == ALERT_STATE_CLASSIFYING && run == ALERT_RUN_DISARM) {
+		disarmAlert();
+	} else if (alarmState == ALERT_STATE_ARMED || alarmState == ALERT_STATE_CLASSIFYING) {
+		if (engineEventPending) {
+			processEngineEvent();
+		}
+	}
+}
+
+/**
+ * Timer callback of the sampling period of the profile.
+ * 
+ * The profile follows the state changes of the classification.
+ */
+static void sampleTick(void * arg) {
+	if (alarmState == ALERT_STATE_ARMED || alarmState == ALERT_STATE_CLASSIFYING) {
+		processSample();
+		updateProfile(currentRun);
+	}
+}
+
+/**
+ * Handles an INT2 event from the LSM303 click or 6D engine.
+ * 
+ * A change of the 6D orientation raises the alert directly. A double
+ * click starts a classification window, single clicks are bumps and are
+ * ignored.
+ */
+static void processEngineEvent() {
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		engineEventPending = false;
+	}
+	
+	uint8_t orientationSrc = lsm303_clear_orientation_interrupt();
+	uint8_t clickSrc = lsm303_clear_click();
+	
+	if (orientationSrc & LSM303_SRC_IA) {
+		raiseIntruderAlert();
+	} else if ((clickSrc & LSM303_CLICK_SRC_DCLICK) && alarmState == ALERT_STATE_ARMED) {
+		startClassification();
+	}
+}
+
+/**
+ * Processes the next accelerometer sample while the alert is armed.
+ * 
+ * Every sample is compared to the arm time orientation to detect a box
+ * that is tilted or carried away, the time over the threshold follows
+ * the sample period of the profile. After the LSM303 threshold has 
+ * triggered the samples are also fed to the vibration classifier, at the
+ * end of the window the alert is raised only for an intrusion pattern,
+ * anything else re-arms the threshold interrupt.
+ */
+static void processSample() {
+	struct lsm303_accel_reading reading;
+	
+	lsm303_read(&reading);
+	if (reading.status != LSM303_OK) {
+		return;
+	}
+	
+	if (orientation_update(reading.x, reading.y, reading.z, profiles[currentProfile].samplePeriod)) {
+		raiseIntruderAlert();
+		return;
+	}
+	
+	if (alarmState != ALERT_STATE_CLASSIFYING) {
+		return;
+	}
+	
+	if (vibration_addSample(reading.x, reading.y, reading.z)) {
+		vibration_getFeatures(&lastFeatures);
+		lastClass = vibration_classify(&lastFeatures);
+		trace(TRACE_ALERT_CLASS, lastClass);
+		
+		if (vibration_isIntrusion(lastClass)) {
+			raiseIntruderAlert();
+		} else {
+			armAlert();
+		}
+	}
+}
+
+
+/**
+ * End of the settle time of the LSM303, the alert can be armed.
+ */
+static void sensorSettled(void * arg) {
+	alarmState = ALERT_STATE_OK;
+	trace(TRACE_ALERT_STATE, ALERT_STATE_OK);
+	
+	// Armed by alert_run()
+	event_post(EVENT_ALERT);
+}
+
+/**
+ * End of a calibration, the result or the defaults are applied to the
+ * threshold interrupt.
+ */
+static void calibrationDone(int status) {
+	calibrating = false;
+	calibrationStatus = status;
+	
+	if (status == CALIBRATION_OK) {
+		calibration_store(&calibration);
+	} else {
+		calibration.threshold = ALERT_ACCEL_THRESHOLD;
+		calibration.duration = ALERT_ACCEL_DURATION;
+		calibration.flags = CALIBRATION_FLAG_DEFAULTS;
+	}
+	lsm303_set_interrupt(calibration.threshold, calibration.duration);
+	
+	if (alarmState == ALERT_STATE_OFF) {
+		if (status == CALIBRATION_OK) {
+			sensorSettled(NULL);
+		} else {
+			// Stored so a reset loop takes the fast path, -calib runs it again
+			calibration_store(&calibration);
+			// Wait for the lsm303 to stabilize otherwise we get a false interrupt
+			timer_start(&settleTimer, ALERT_INIT_DELAY_MS, 0);
+		}
+	} else {
+		// The profile of the run status is restored by alert_run()
+		event_post(EVENT_ALERT);
 	}
 }
 
+/**
+ * Timer callback of the calibration, one reading per period.
+ */
+static void calibrationTick(void * arg) {
+	struct lsm303_accel_reading reading;
+	
+	lsm303_read(&reading);
+	int status = calibration_feed(&reading, &calibration);
+	if (status != CALIBRATION_BUSY) {
+		timer_stop(&calibrationTimer);
+		calibrationDone(status);
+	}
+}
 
 /*
  * @see alert.h
  */
 int alert_init() {
-	lsm303_init(LSM303_DATA_RATE_25HZ, LSM303_FS_4G);
-	lsm303_set_interrupt(ALERT_ACCEL_THRESHOLD, ALERT_ACCEL_DURATION);
+	timer_init(&quietTimer, quietPeriodEnd, NULL);
+	timer_init(&sampleTimer, sampleTick, NULL);
+	timer_init(&settleTimer, sensorSettled, NULL);
+	timer_init(&calibrationTimer, calibrationTick, NULL);
 	
-	// Wait for the lsm303 to stabilize otherwise we get a false interrupt
-	_delay_ms(ALERT_INIT_DELAY_MS);
+	lsm303_init(ALERT_ARMED_DATA_RATE, ALERT_ACCEL_SCALE);
+	lsm303_set_click(ALERT_CLICK_AXES, ALERT_CLICK_THRESHOLD, ALERT_CLICK_TIME_LIMIT, ALERT_CLICK_LATENCY, ALERT_CLICK_WINDOW);
+	lsm303_set_orientation_interrupt(LSM303_ORIENTATION_6D_MOVEMENT, ALERT_6D_THRESHOLD, ALERT_6D_DURATION);
 	
 	// Int on rising edge.
 	EICRA |= _BV(ISC00) | _BV(ISC01);
 	
-	alarmState = ALERT_STATE_OK;
+	// INT2 pin change, enabled in the mask only while armed
+	ioctl_setdir(&ACCEL_INT2_DDR, ACCEL_INT2_IO, INPUT);
+	PCICR |= _BV(ACCEL_INT2_PCIE);
+	
+	alarmState = ALERT_STATE_OFF;
+	if (calibration_load(&calibration)) {
+		// Known noise floor, only wait for the first samples
+		lsm303_set_interrupt(calibration.threshold, calibration.duration);
+		timer_start(&settleTimer, ALERT_INIT_FAST_DELAY_MS, 0);
+	} else {
+		alert_calibrate();
+	}
 	return 1;
 }
 
+/*
+ * @see alert.h
+ */
+bool alert_isReady() {
+	return alarmState != ALERT_STATE_OFF;
+}
+
+/*
+ * @see alert.h
+ */
+bool alert_calibrate() {
+	if (calibrating || alarmState == ALERT_STATE_ARMED || alarmState == ALERT_STATE_CLASSIFYING) {
+		return false;
+	}
+	
+	// Sampled at the rate of the armed profile, restored by alert_run()
+	lsm303_set_mode(profiles[ALERT_PROFILE_ARMED].rate, ALERT_ACCEL_SCALE, profiles[ALERT_PROFILE_ARMED].mode);
+	currentProfile = PROFILE_NONE;
+	timer_stop(&sampleTimer);
+	
+	calibration_start(ALERT_CALIBRATION_SIGMAS, ALERT_ACCEL_THRESHOLD, ALERT_ACCEL_DURATION);
+	calibrating = true;
+	calibrationStatus = CALIBRATION_BUSY;
+	timer_start(&calibrationTimer, ALERT_CALIBRATION_SAMPLE_MS, ALERT_CALIBRATION_SAMPLE_MS);
+	return true;
+}
+
+/*
+ * @see alert.h
+ */
+int alert_getCalibration(struct calibration_result * result) {
+	*result = calibration;
+	return calibrationStatus;
+}
+
 /**
- * Wait using the timer0, used to quiet the alarm on interuders status.
+ * Starts the quiet period of the alarm on intruder status.
  * 
- * This will prevent multiple sequential event of alert in a 5sec interval.
+ * This will prevent multiple sequential event of alert in a 
+ * ALERT_QUIET_PERIOD_MS interval.
  */
 static void wait() {
-  TCCR0B |= (1 << CS02) | (1 << CS00); // Set the prescalar to 1024
-  TIMSK0 |= (1 << TOIE0); // Enable the Timer0 overflow Interrupt
-  TCNT0 = 0; // Set the counter to 0
-  timerCount = 0;
+	timer_start(&quietTimer, ALERT_QUIET_PERIOD_MS, 0);
 }
 
-
 /**
- * Waiting ISR to manage the quiet time of the alarm on intruder alert.
+ * End of the quiet time of the alarm on intruder alert.
  * 
  * @see #wait()
  */
-ISR(TIMER0_OVF_vect) {
-    timerCount++;
-    // B/c 16 MHz / 1024 / 256 => overflows / s * 5 s
-    if(timerCount >= 305) {
-      if (alarmState == ALERT_STATE_INTRUDER) {
-		  ioctl_write(&LED_ALIVE_PORT, LED_ALIVE_IO, 0);
-		  alarmState = ALERT_STATE_OK;
-	  }
-      timerCount = 0;
-      // Disable timer
-      TCCR0B = 0;
-      // disable timer interrupt
-      TIMSK0 &= ~(_BV(TOIE0));
-      
-    }
+static void quietPeriodEnd(void * arg) {
+	if (alarmState == ALERT_STATE_INTRUDER) {
+		ioctl_write(&LED_ALIVE_PORT, LED_ALIVE_IO, 0);
+		alarmState = ALERT_STATE_OK;
+		trace(TRACE_ALERT_STATE, ALERT_STATE_OK);
+		
+		// Re-armed by alert_run()
+		event_post(EVENT_ALERT);
+	}
 }
 
 
+/**
+ * Deferred work of the EXTINT0, the classification starts with the I2C
+ * clear of the LSM303 latch.
+ */
+static void thresholdEvent(void * arg) {
+	if (alarmState == ALERT_STATE_ARMED) {
+		startClassification();
+		event_post(EVENT_ALERT);
+	}
+}
+
 /**
  * EXTINT0 when LSM303 initiates an interrupt.
  * 
- * This is the intruder alert.
+ * This is the intruder trigger, the samples that follow are classified
+ * from the sampling timer before raising the alert. The INT0 stays 
+ * disabled until the LSM303 latch is cleared at task level.
  */
 ISR(INT0_vect) {
-	if (alarmState == ALERT_STATE_ARMED) {
-		disableAlertInterrupt();
-		spicmd_send(SPICMD_BBB_ALERT);
-		ioctl_write(&LED_ALIVE_PORT, LED_ALIVE_IO, 1);
-		alarmState = ALERT_STATE_INTRUDER;
-		wait();
+	ISR_PROFILE_ENTER();
+	EIMSK &= ~_BV(INT0);
+	trace(TRACE_ALERT_INT, 1);
+	workqueue_post(thresholdEvent, NULL);
+	ISR_PROFILE_EXIT(ISRPROF_INT0);
+}
+
+/**
+ * Pin change on the LSM303 INT2 for the click and 6D engines.
+ * 
+ * The sources are read in alert_run(), the INT2 stays latched until then.
+ */
+ISR(ACCEL_INT2_vect) {
+	ISR_PROFILE_ENTER();
+	if (ioctl_read(&ACCEL_INT2_PIN, ACCEL_INT2_IO)) {
+		trace(TRACE_ALERT_INT, 2);
+		engineEventPending = true;
+		event_post(EVENT_ALERT);
 	}
+	ISR_PROFILE_EXIT(ISRPROF_ACCEL_INT2);
 }
@@ -5,7 +5,7 @@
  * Will unlock and open the box
  */
 int spicmd_callback_unlockopen() {
-    box_setState(BOX_STATE_PENDING_OPEN);
+    box_postEvent(BOX_EVENT_CMD_OPEN);
     return 0;
 }
 
@@ -13,7 +13,7 @@ int spicmd_callback_unlockopen() {
  * Will close and lock the box
  */
 int spicmd_callback_closelock() {
-    box_setState(BOX_STATE_PENDING_CLOSE);
+    box_postEvent(BOX_EVENT_CMD_CLOSE);
     return 0;
 }
 
@@ -22,6 +22,6 @@ int spicmd_callback_closelock() {
  * @return 0 if closed, 1 if open
  */
 int spicmd_callback_checkstatus() {
-    box_setState(BOX_STATUS_QUERY);
+    box_postEvent(BOX_EVENT_CMD_QUERY);
     return 0;
 };
@@ -1,16 +1,366 @@
 #include "box_control.h"
-#include "util/delay.h"
+#include <stddef.h>
+#include <string.h>
+#include <util/atomic.h>
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
 #include "pin_config.h"
 #include "spi_command.h"
 #include "ioctl.h"
-// TODO remove #include "uart.h" 
-// TODO remove #include <stdlib.h> 
+#include "motion.h"
+#include "timerwheel.h"
+#include "systick.h"
+#include "defineConfig.h"
+#include "isrprof.h"
+
+// Action results, negative values are failures
+#define ACTION_DONE 0 // Take the transition
+#define ACTION_WAIT 1 // Stay in the current state, keep the deadline
+
+// Transition of a state that doesn't change the state
+#define NO_TRANSITION 0xFF
 
 typedef uint8_t State;
-static volatile State state; 
+typedef uint8_t Event;
+
+/**
+ * Transition of the box state machine.
+ *
+ * The action is called when the event is received in the state, the
+ * state then changes to next. The next transition must happen within
+ * the deadline, otherwise the action is retried up to retries times and
+ * the box goes to BOX_STATE_FAULT.
+ */
+struct transition {
+    State state;
+    Event event;
+    int (*action)(void);
+    State next;
+    uint16_t deadline;
+    uint8_t retries;
+};
+
+static int startUnlock(void);
+static int startOpen(void);
+static int finishOpen(void);
+static int startClose(void);
+static int finishClose(void);
+static int startLock(void);
+static int sendStatus(void);
+
+/**
+ * Transition table, the first match of the state and event is taken.
+ */
+static const struct transition transitions[] PROGMEM = {
+    // Opening
+    {BOX_STATE_IDLE_CLOSED, BOX_EVENT_CMD_OPEN,   startUnlock, BOX_STATE_UNLOCKING,   BOX_UNLOCK_DEADLINE_MS, BOX_RETRIES},
+    {BOX_STATE_UNLOCKING,   BOX_EVENT_LOCK_CLEAR, startOpen,   BOX_STATE_OPENING,     BOX_OPEN_DEADLINE_MS,   BOX_RETRIES},
+    {BOX_STATE_OPENING,     BOX_EVENT_LID_DONE,   finishOpen,  BOX_STATE_IDLE_OPEN,   0, 0},
+    {BOX_STATE_OPENING,     BOX_EVENT_LID_OPENED, finishOpen,  BOX_STATE_IDLE_OPEN,   0, 0},
+    // Closing
+    {BOX_STATE_IDLE_OPEN,   BOX_EVENT_CMD_CLOSE,  startClose,  BOX_STATE_CLOSING,     BOX_CLOSE_DEADLINE_MS,  BOX_RETRIES},
+    {BOX_STATE_CLOSING,     BOX_EVENT_LID_DONE,   finishClose, BOX_STATE_LOCKING,     BOX_LOCK_DEADLINE_MS,   BOX_RETRIES},
+    {BOX_STATE_CLOSING,     BOX_EVENT_LID_CLOSED, finishClose, BOX_STATE_LOCKING,     BOX_LOCK_DEADLINE_MS,   BOX_RETRIES},
+    {BOX_STATE_LOCKING,     BOX_EVENT_LOCK_DONE,  NULL,        BOX_STATE_IDLE_CLOSED, 0, 0},
+    {BOX_STATE_IDLE_CLOSED, BOX_EVENT_CMD_CLOSE,  startLock,   BOX_STATE_LOCKING,     BOX_LOCK_DEADLINE_MS,   BOX_RETRIES},
+    // Reversals while moving
+    {BOX_STATE_UNLOCKING,   BOX_EVENT_CMD_CLOSE,  startLock,   BOX_STATE_LOCKING,     BOX_LOCK_DEADLINE_MS,   BOX_RETRIES},
+    {BOX_STATE_OPENING,     BOX_EVENT_CMD_CLOSE,  startClose,  BOX_STATE_CLOSING,     BOX_CLOSE_DEADLINE_MS,  BOX_RETRIES},
+    {BOX_STATE_CLOSING,     BOX_EVENT_CMD_OPEN,   startOpen,   BOX_STATE_OPENING,     BOX_OPEN_DEADLINE_MS,   BOX_RETRIES},
+    {BOX_STATE_LOCKING,     BOX_EVENT_CMD_OPEN,   startUnlock, BOX_STATE_UNLOCKING,   BOX_UNLOCK_DEADLINE_MS, BOX_RETRIES},
+    {BOX_STATE_LOCKING,     BOX_EVENT_LID_OPENED, NULL,        BOX_STATE_FAULT,       0, 0},
+    // Lid moved by hand
+    {BOX_STATE_IDLE_CLOSED, BOX_EVENT_LID_OPENED, NULL,        BOX_STATE_IDLE_OPEN,   0, 0},
+    {BOX_STATE_IDLE_OPEN,   BOX_EVENT_LID_CLOSED, NULL,        BOX_STATE_IDLE_CLOSED, 0, 0},
+    // Recovery
+    {BOX_STATE_FAULT,       BOX_EVENT_CMD_OPEN,   startUnlock, BOX_STATE_UNLOCKING,   BOX_UNLOCK_DEADLINE_MS, BOX_RETRIES},
+    {BOX_STATE_FAULT,       BOX_EVENT_CMD_CLOSE,  startClose,  BOX_STATE_CLOSING,     BOX_CLOSE_DEADLINE_MS,  BOX_RETRIES},
+    // Any state
+    {BOX_STATE_ANY,         BOX_EVENT_CMD_QUERY,  sendStatus,  NO_TRANSITION,         0, 0},
+};
+
+#define TRANSITION_COUNT (sizeof(transitions) / sizeof(transitions[0]))
+
+/**
+ * Servo channels, indexed by LID_MOTOR and LOCK_MOTOR.
+ */
+static const struct servo_descriptor servos[] = {
+    {&SERVO_A_PORT, &SERVO_A_DDR, SERVO_A_IO, SERVO_A_OUTPUT, 0, 0},
+    {&SERVO_B_PORT, &SERVO_B_DDR, SERVO_B_IO, SERVO_B_OUTPUT, 0, 0},
+};
+
+static volatile State state;
+static volatile uint16_t pendingEvents;
+
+// Transition that armed the deadline, its action is retried on timeout
+static struct transition activeTransition;
+static uint8_t retriesLeft;
+static bool deadlineArmed;
+static struct timer deadlineTimer;
+
+// The lock servo is only initialized once the lid has been closed
+static bool lockReady;
+
+// A known idle state was reached since boot
+static bool ready;
+
+// Debounced reed switch
+static volatile bool switchBouncing;    // Bounce not seen by debounceSwitch() yet
+static volatile bool switchBurst;       // Bounces until switchSettled()
+static volatile uint32_t switchBounceStart;
+static int switchOpen;
+static uint32_t switchEdge;
+static struct timer debounceTimer;
+
+/**
+ * Deadline timer callback.
+ */
+static void deadlineExpired(void * arg) {
+    box_postEvent(BOX_EVENT_TIMEOUT);
+}
+
+/**
+ * Motion callback, the lock is past the latch.
+ */
+static void lockClear(int channel) {
+    box_postEvent(BOX_EVENT_LOCK_CLEAR);
+}
+
+/**
+ * Motion callback, the lock reached its target.
+ */
+static void lockDone(int channel) {
+    box_postEvent(BOX_EVENT_LOCK_DONE);
+}
+
+/**
+ * Motion callback, the lid reached its target.
+ */
+static void lidDone(int channel) {
+    box_postEvent(BOX_EVENT_LID_DONE);
+}
+
+/**
+ * Motion callback, the lid backed off from a jammed close, close again.
+ */
+static void lidRetryClose(int channel) {
+    motion_move(LID_MOTOR, LID_CLOSED_POSITION, LID_VELOCITY, LID_ACCELERATION, lidDone);
+}
+
+/**
+ * Starts the lock move to the unlocked position.
+ *
+ * The lid can start opening as soon as the latch is clear.
+ */
+static int startUnlock(void) {
+    if (!lockReady || motion_position(LOCK_MOTOR) >= LOCK_CLEAR_POSITION) {
+        box_postEvent(BOX_EVENT_LOCK_CLEAR);
+    } else {
+        motion_setTrigger(LOCK_MOTOR, LOCK_CLEAR_POSITION, lockClear);
+    }
+
+    if (!lockReady) {
+        return 0;
+    }
+    return motion_move(LOCK_MOTOR, LOCK_UNLOCKED_POSITION, LOCK_VELOCITY, LOCK_ACCELERATION, NULL);
+}
+
+/**
+ * Starts the lid move to the open position.
+ */
+static int startOpen(void) {
+    servo_setHoldTime(LID_MOTOR, 0);
+    return motion_move(LID_MOTOR, LID_OPEN_POSITION, LID_VELOCITY, LID_ACCELERATION, lidDone);
+}
+
+/**
+ * The lid is open when it reached its target and the switch is open.
+ */
+static int finishOpen(void) {
+    if (box_isClosed() || !motion_isDone(LID_MOTOR)) {
+        return ACTION_WAIT;
+    }
+    return ACTION_DONE;
+}
+
+/**
+ * Starts the lid move to the closed position.
+ *
+ * If the lid is already at its closed position but the switch is still
+ * open, the lid is jammed: it backs off before closing again.
+ */
+static int startClose(void) {
+    servo_setHoldTime(LID_MOTOR, LID_CLOSED_HOLD_MS);
+    if (box_isClosed()) {
+        box_postEvent(BOX_EVENT_LID_CLOSED);
+    }
+
+    if (motion_isDone(LID_MOTOR) && motion_position(LID_MOTOR) == LID_CLOSED_POSITION && box_isOpen()) {
+        return motion_move(LID_MOTOR, LID_CLOSED_POSITION - LID_RETRY_BACKOFF, LID_VELOCITY, LID_ACCELERATION, lidRetryClose);
+    }
+    return motion_move(LID_MOTOR, LID_CLOSED_POSITION, LID_VELOCITY, LID_ACCELERATION, lidDone);
+}
+
+/**
+ * Starts the lock move to the locked position.
+ *
+ * The lock servo is initialized directly in the locked position the
+ * first time.
+ */
+static int startLock(void) {
+    if (box_isOpen()) {
+        return -1;
+    }
+
+    if (!lockReady) {
+        lockReady = true;
+        box_postEvent(BOX_EVENT_LOCK_DONE);
+        return servo_channel_init_angle(LOCK_MOTOR, SERVO_DEGREES(LOCK_LOCKED_POSITION));
+    }
+    return motion_move(LOCK_MOTOR, LOCK_LOCKED_POSITION, LOCK_VELOCITY, LOCK_ACCELERATION, lockDone);
+}
+
+/**
+ * The lid is closed when it reached its target and the switch is closed,
+ * then the lock starts.
+ */
+static int finishClose(void) {
+    if (box_isOpen() || !motion_isDone(LID_MOTOR)) {
+        return ACTION_WAIT;
+    }
+    return startLock();
+}
+
+/**
+ * Sends the switch state to the BBB.
+ */
+static int sendStatus(void) {
+    spicmd_send(box_isOpen() ? SPICMD_RESP_OPENED : SPICMD_RESP_CLOSED);
+    return ACTION_DONE;
+}
+
+/**
+ * Enters the fault state: motors are stopped where they are and the BBB
+ * is notified.
+ */
+static void enterFault() {
+    trace(TRACE_BOX_FAULT, state);
+    motion_setTrigger(LOCK_MOTOR, LOCK_CLEAR_POSITION, NULL);
+    motion_stop(LID_MOTOR);
+    motion_stop(LOCK_MOTOR);
+    timer_stop(&deadlineTimer);
+    deadlineArmed = false;
+    state = BOX_STATE_FAULT;
+    ready = true;
+    spicmd_send(SPICMD_BBB_BOX_FAULT);
+}
+
+/**
+ * Takes a transition after its action.
+ */
+static void takeTransition(const struct transition * t) {
+    int result = (t->action != NULL) ? t->action() : ACTION_DONE;
+
+    if (result < 0 || t->next == BOX_STATE_FAULT) {
+        enterFault();
+        return;
+    }
+    if (result == ACTION_WAIT || t->next == NO_TRANSITION) {
+        return;
+    }
+
+    state = t->next;
+    trace(TRACE_BOX_STATE, state);
+    if (state == BOX_STATE_IDLE_CLOSED) {
+        ready = true;
+    }
+    activeTransition = *t;
+    retriesLeft = t->retries;
+    deadlineArmed = (t->deadline != 0);
+    if (deadlineArmed) {
+        timer_start(&deadlineTimer, t->deadline, 0);
+    } else {
+        timer_stop(&deadlineTimer);
+    }
+}
+
+/**
+ * Retries the action of the active transition, or fails.
+ */
+static void handleTimeout() {
+    // Stale timeout of a deadline that was re-armed or cleared since
+    if (!deadlineArmed || timer_isActive(&deadlineTimer)) {
+        return;
+    }
+
+    if (retriesLeft == 0 || activeTransition.action == NULL || activeTransition.action() < 0) {
+        enterFault();
+        return;
+    }
+    retriesLeft--;
+    timer_start(&deadlineTimer, activeTransition.deadline, 0);
+}
+
+/**
+ * Finds and takes the transition of an event in the current state.
+ */
+static void handleEvent(Event event) {
+    struct transition t;
+
+    trace(TRACE_BOX_EVENT, event);
+
+    if (event == BOX_EVENT_TIMEOUT) {
+        handleTimeout();
+        return;
+    }
+
+    for (uint8_t i = 0; i < TRANSITION_COUNT; i++) {
+        memcpy_P(&t, &transitions[i], sizeof(t));
+        if (t.event == event && (t.state == state || t.state == BOX_STATE_ANY)) {
+            takeTransition(&t);
+            return;
+        }
+    }
+}
+
+/**
+ * Debounce timer callback, the switch has been quiet for
+ * BOX_SWITCH_DEBOUNCE_MS. An edge is posted if its level changed.
+ */
+static void switchSettled(void * arg) {
+    int isOpen = ioctl_read(&BOX_SWITCH_PIN, BOX_SWITCH_IO);
+    uint32_t burstStart;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        burstStart = switchBounceStart;
+        switchBurst = false;
+    }
+    if (isOpen != switchOpen) {
+        switchOpen = isOpen;
+        switchEdge = burstStart;
+        box_postEvent(isOpen ? BOX_EVENT_LID_OPENED : BOX_EVENT_LID_CLOSED);
+    }
+}
+
+/**
+ * Restarts the debounce timer on every bounce seen by the interrupt.
+ */
+static void debounceSwitch() {
+    bool bouncing;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        bouncing = switchBouncing;
+        switchBouncing = false;
+    }
+    if (bouncing) {
+        timer_start(&debounceTimer, BOX_SWITCH_DEBOUNCE_MS, 0);
+    }
+}
 
 /**
  * Initializes the box for use by preparing its motors
+ *
+ * If the lid is open, it is closed and locked in the background.
  */
 int box_init() {
     int success = 0;
@@ -19,69 +369,81 @@ int box_init() {
     ioctl_setdir(&BOX_SWITCH_DDR, BOX_SWITCH_IO, INPUT);
     ioctl_pullup(&BOX_SWITCH_PORT, BOX_SWITCH_IO);
 
+    timer_init(&deadlineTimer, deadlineExpired, NULL);
+    timer_init(&debounceTimer, switchSettled, NULL);
+    switchOpen = ioctl_read(&BOX_SWITCH_PIN, BOX_SWITCH_IO);
+    switchEdge = systick_millis();
+    switchBouncing = false;
+    switchBurst = false;
+    BOX_SWITCH_PCMSK |= _BV(BOX_SWITCH_PCINT);
+    PCICR |= _BV(BOX_SWITCH_PCIE);
+    pendingEvents = 0;
+    deadlineArmed = false;
+    lockReady = false;
+
     // Initialize the servo motors
 
-    success -= servo_init();
-    success -= servo_channel_init_angle(LID_MOTOR, LID_CLOSED_POSITION);
-    while(box_isOpen()) {
-        // Wait
-    };
-    success -= servo_channel_init_angle(LOCK_MOTOR, LOCK_LOCKED_POSITION);
+    success -= servo_init(servos, LENGTH_OF_ARRAY(servos));
+    success -= servo_setHoldTime(LOCK_MOTOR, LOCK_HOLD_MS);
+    success -= servo_setHoldTime(LID_MOTOR, LID_CLOSED_HOLD_MS);
+    success -= servo_channel_init_angle(LID_MOTOR, SERVO_DEGREES(LID_CLOSED_POSITION));
+
+    if (switchOpen) {
+        state = BOX_STATE_IDLE_OPEN;
+        ready = false;
+        box_postEvent(BOX_EVENT_CMD_CLOSE);
+    } else {
+        success -= servo_channel_init_angle(LOCK_MOTOR, SERVO_DEGREES(LOCK_LOCKED_POSITION));
+        lockReady = true;
+        state = BOX_STATE_IDLE_CLOSED;
+        ready = true;
+    }
 
-    state = BOX_STATE_IDLE_CLOSED;
     return success;
 }
 
-/**
- * Returns the state that the box is in
- * 
- * BOX_STATE_IDLE_OPEN     0x01
- * BOX_STATE_PENDING_OPEN  0x02
- * BOX_STATE_IDLE_CLOSED   0x03
- * BOX_STATE_PENDING_CLOSE 0x04
+/*
+ * @see box_control.h
+ */
+bool box_isReady() {
+    return ready;
+}
+
+/*
+ * @see box_control.h
  */
 int box_getState() {
     return state;
 }
 
-/**
- * Sets the state that the box is in
- * 
- * BOX_STATE_IDLE_OPEN     0x01
- * BOX_STATE_PENDING_OPEN  0x02
- * BOX_STATE_IDLE_CLOSED   0x03
- * BOX_STATE_PENDING_CLOSE 0x04
+/*
+ * @see box_control.h
  */
-void box_setState(uint8_t newState) {
-    state = newState;
+void box_postEvent(uint8_t event) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        pendingEvents |= (1 << event);
+    }
+    event_post(EVENT_BOX);
 }
 
 /**
- * Tells the box to take care of the state that it is currently in.
- */ 
+ * Tells the box to handle the events posted since the last call.
+ */
 void box_handleCurrentState() {
-    int isOpen;
-    switch(state) {
-        case BOX_STATE_PENDING_OPEN:
-            box_unlock();
-            box_open();
-            break;
-        case BOX_STATE_PENDING_CLOSE:
-            box_close();
-            while(box_isOpen()){};
-            box_lock();
-            break;
-        case BOX_STATUS_QUERY:
-            isOpen = box_isOpen();
-            if(isOpen) {
-                spicmd_send(SPICMD_RESP_OPENED);
-                state = BOX_STATE_IDLE_OPEN;
-            } else {
-                spicmd_send(SPICMD_RESP_CLOSED);
-                state = BOX_STATE_IDLE_CLOSED;
-            }
-           	// TODO remove fprintf(&uartStream, "Is switch open? %d\n", box_isOpen());
+    uint16_t events;
 
+    debounceSwitch();
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        events = pendingEvents;
+        pendingEvents = 0;
+    }
+
+    // Timeouts have the highest index so they are handled last
+    for (Event event = 0; events != 0; event++, events >>= 1) {
+        if (events & 1) {
+            handleEvent(event);
+        }
     }
 }
 
@@ -109,12 +471,7 @@ int box_unlock() {
         return -1;
     }
 
-    int success = 0;
-    for(int angle = LOCK_LOCKED_POSITION; angle <= LOCK_UNLOCKED_POSITION; angle += 30) {
-        success -= servo_write(LOCK_MOTOR, angle);
-        _delay_ms(105); // 0.21 s / 60 deg * 30 deg
-    }
-    return success;
+    return motion_move(LOCK_MOTOR, LOCK_UNLOCKED_POSITION, LOCK_VELOCITY, LOCK_ACCELERATION, NULL);
 }
 
 /**
@@ -126,7 +483,7 @@ int box_lock() {
         return -1;
     }
 
-    return servo_write(LOCK_MOTOR, LOCK_LOCKED_POSITION);
+    return motion_move(LOCK_MOTOR, LOCK_LOCKED_POSITION, LOCK_VELOCITY, LOCK_ACCELERATION, NULL);
 }
 
 /**
@@ -138,8 +495,7 @@ int box_close() {
         return -1;
     }
 
-    state = BOX_STATE_IDLE_CLOSED;
-    return servo_write(LID_MOTOR, LID_CLOSED_POSITION);
+    return motion_move(LID_MOTOR, LID_CLOSED_POSITION, LID_VELOCITY, LID_ACCELERATION, NULL);
 }
 
 /**
@@ -151,8 +507,7 @@ int box_open() {
         return -1;
     }
 
-    state = BOX_STATE_IDLE_OPEN;
-    return servo_write(LID_MOTOR, LID_OPEN_POSITION);
+    return motion_move(LID_MOTOR, LID_OPEN_POSITION, LID_VELOCITY, LID_ACCELERATION, NULL);
 }
 
 /**
@@ -160,7 +515,32 @@ int box_open() {
  * @return 1 if open, 0 if not
  */
 int box_isOpen() {
-    return ioctl_read(&BOX_SWITCH_PIN, BOX_SWITCH_IO);
+    return switchOpen;
+}
+
+/*
+ * @see box_control.h
+ */
+uint32_t box_lastSwitchEdge() {
+    return switchEdge;
+}
+
+/**
+ * Any level change of the reed switch, the first change of a burst is
+ * the timestamp of the edge. The burst lasts until the switch settles,
+ * across the passes of the main loop that restart the debounce timer.
+ */
+ISR(BOX_SWITCH_vect) {
+    ISR_PROFILE_ENTER();
+    if (!switchBurst) {
+        switchBounceStart = systick_millis();
+        switchBurst = true;
+    }
+    if (!switchBouncing) {
+        switchBouncing = true;
+        event_post(EVENT_BOX);
+    }
+    ISR_PROFILE_EXIT(ISRPROF_BOX_SWITCH);
 }
 
 /**
@@ -0,0 +1,206 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <avr/eeprom.h>
+#include "calibration.h"
+#include "lsm303.h"
+#include "cordic.h"
+
+#define AXIS_COUNT			(3)
+#define INT1_AXIS_COUNT		(2) // X and Y high events
+#define REG_VALUE_MAX		(0x7F)
+
+#define STORE_MAGIC			(0xCB)
+
+struct storedCalibration {
+	uint8_t magic;
+	struct calibration_result result;
+	uint8_t checksum;
+};
+
+enum phase {
+	PHASE_IDLE,
+	PHASE_DISCARD,	// The sensor settles
+	PHASE_STATS,	// Sums of the mean and variance
+	PHASE_VERIFY	// Longest noise burst over the threshold
+};
+
+static struct storedCalibration EEMEM storedCalibration;
+
+// Calibration in progress
+static enum phase phase = PHASE_IDLE;
+static uint8_t samples;
+static uint8_t missed;
+static uint8_t sigmas;
+static uint8_t minThreshold;
+static uint8_t minDuration;
+static int32_t sum[AXIS_COUNT];
+static uint32_t sumSquares[AXIS_COUNT];
+static uint8_t run;
+static uint8_t longestRun;
+static struct calibration_result current;
+
+/**
+ * Simple XOR checksum of the stored result.
+ */
+static uint8_t checksum(const struct calibration_result * result) {
+	const uint8_t * bytes = (const uint8_t *) result;
+	uint8_t sum = STORE_MAGIC;
+	
+	for (uint8_t i = 0; i < sizeof(*result); i++) {
+		sum ^= bytes[i];
+	}
+	return sum;
+}
+
+/*
+ * @see calibration.h
+ */
+void calibration_start(uint8_t sigmasOverFloor, uint8_t lowestThreshold, uint8_t lowestDuration) {
+	sigmas = sigmasOverFloor;
+	minThreshold = lowestThreshold;
+	minDuration = lowestDuration;
+	
+	for (uint8_t axis = 0; axis < AXIS_COUNT; axis++) {
+		sum[axis] = 0;
+		sumSquares[axis] = 0;
+	}
+	run = 0;
+	longestRun = 0;
+	samples = 0;
+	missed = 0;
+	phase = PHASE_DISCARD;
+}
+
+/**
+ * End of the statistics window: mean and sigma of each axis, then the
+ * threshold over the X/Y floor.
+ */
+static void computeThreshold() {
+	// var = E[x^2] - E[x]^2
+	uint16_t level = 0;
+	for (uint8_t axis = 0; axis < AXIS_COUNT; axis++) {
+		int16_t mean = sum[axis] >> CALIBRATION_SAMPLES_SHIFT;
+		uint32_t meanSquare = sumSquares[axis] >> CALIBRATION_SAMPLES_SHIFT;
+		uint32_t square = (int32_t) mean * mean;
+		
+		current.mean[axis] = mean;
+		current.sigma[axis] = cordic_sqrt(meanSquare > square ? meanSquare - square : 0);
+		
+		if (axis < INT1_AXIS_COUNT) {
+			uint16_t axisLevel = abs(mean) + (uint16_t) sigmas * current.sigma[axis];
+			if (axisLevel > level) {
+				level = axisLevel;
+			}
+		}
+	}
+	
+	uint16_t threshold = (level + CALIBRATION_THS_RAW_LSB - 1) / CALIBRATION_THS_RAW_LSB;
+	if (threshold < minThreshold) {
+		threshold = minThreshold;
+	} else if (threshold > REG_VALUE_MAX) {
+		threshold = REG_VALUE_MAX;
+	}
+	current.threshold = threshold;
+}
+
+/*
+ * @see calibration.h
+ */
+int calibration_feed(const struct lsm303_accel_reading * reading, struct calibration_result * result) {
+	if (phase == PHASE_IDLE) {
+		return CALIBRATION_ERR_TIMEOUT;
+	}
+	
+	if (reading->status != LSM303_OK) {
+		if (++missed >= CALIBRATION_MAX_MISSED) {
+			phase = PHASE_IDLE;
+			return CALIBRATION_ERR_TIMEOUT;
+		}
+		return CALIBRATION_BUSY;
+	}
+	missed = 0;
+	samples++;
+	
+	switch (phase) {
+		case PHASE_DISCARD:
+			if (samples == CALIBRATION_DISCARD_SAMPLES) {
+				samples = 0;
+				phase = PHASE_STATS;
+			}
+			break;
+		
+		case PHASE_STATS: {
+			int16_t raw[AXIS_COUNT] = {reading->x, reading->y, reading->z};
+			for (uint8_t axis = 0; axis < AXIS_COUNT; axis++) {
+				sum[axis] += raw[axis];
+				sumSquares[axis] += (int32_t) raw[axis] * raw[axis];
+			}
+			if (samples == CALIBRATION_SAMPLES) {
+				computeThreshold();
+				samples = 0;
+				phase = PHASE_VERIFY;
+			}
+			break;
+		}
+		
+		case PHASE_VERIFY: {
+			// Longest burst of samples over half the threshold, the duration must outlast it
+			uint16_t burstLevel = (current.threshold * CALIBRATION_THS_RAW_LSB) / 2;
+			if ((uint16_t) abs(reading->x) > burstLevel || (uint16_t) abs(reading->y) > burstLevel) {
+				run++;
+				if (run > longestRun) {
+					longestRun = run;
+				}
+			} else {
+				run = 0;
+			}
+			if (samples == CALIBRATION_VERIFY_SAMPLES) {
+				current.duration = (longestRun + 1 > minDuration) ? longestRun + 1 : minDuration;
+				current.flags = 0;
+				*result = current;
+				phase = PHASE_IDLE;
+				return CALIBRATION_OK;
+			}
+			break;
+		}
+		
+		default:
+			break;
+	}
+	return CALIBRATION_BUSY;
+}
+
+/*
+ * @see calibration.h
+ */
+bool calibration_load(struct calibration_result * result) {
+	struct storedCalibration stored;
+	
+	eeprom_read_block(&stored, &storedCalibration, sizeof(stored));
+	if (stored.magic != STORE_MAGIC || stored.checksum != checksum(&stored.result)) {
+		return false;
+	}
+	
+	*result = stored.result;
+	return true;
+}
+
+/*
+ * @see calibration.h
+ */
+void calibration_store(const struct calibration_result * result) {
+	struct storedCalibration stored;
+	
+	stored.magic = STORE_MAGIC;
+	stored.result = *result;
+	stored.checksum = checksum(result);
+	eeprom_update_block(&stored, &storedCalibration, sizeof(stored));
+}
+
+/*
+ * @see calibration.h
+ */
+void calibration_clear() {
+	eeprom_update_byte(&storedCalibration.magic, 0xFF);
+}
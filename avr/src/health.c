@@ -0,0 +1,132 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/io.h>
+#include <avr/wdt.h>
+#include <util/atomic.h>
+#include "health.h"
+#include "spi_command.h"
+#include "systick.h"
+#include "event.h"
+#include "workqueue.h"
+#include "uart.h"
+#include "i2c.h"
+#include "memstat.h"
+#include "isrprof.h"
+#include "box_control.h"
+#include "alert.h"
+
+// Kept out of .bss, it is written before .bss is cleared
+static uint8_t resetCause __attribute__((section(".noinit")));
+
+// Double buffer, the BBB shifts one block while the next is written
+static struct health_block blocks[2];
+static volatile uint8_t published = 0;
+
+static uint16_t loops = 0;
+static uint16_t heartbeat = 0;
+static uint16_t linkUp;
+static uint16_t lastIsrHits[ISRPROF_VECTORS];
+
+#if HEALTH_ISR_VECTORS != ISRPROF_VECTORS
+#error HEALTH_ISR_VECTORS must match ISRPROF_VECTORS of isrprof.h
+#endif
+
+void health_saveResetCause(void) __attribute__((naked, used, section(".init3")));
+
+/**
+ * Saves and clears the reset cause before the C runtime initialization.
+ * 
+ * The watchdog stays enabled after a watchdog reset, it is disabled.
+ */
+void health_saveResetCause(void) {
+	resetCause = MCUSR;
+#if defined(__AVR__)
+	if (resetCause == 0) {
+		__asm__ __volatile__ ("mov %0, r2" : "=r" (resetCause));
+	}
+#endif
+	MCUSR = 0;
+	wdt_disable();
+}
+
+/**
+ * SPI block of the last published counters.
+ * 
+ * Called from the SPI interrupt.
+ */
+static uint8_t healthBlock(const uint8_t ** data) {
+	struct health_block * block = &blocks[published];
+	
+	block->ready = (box_isReady() ? HEALTH_READY_BOX : 0) | (alert_isReady() ? HEALTH_READY_ALERT : 0);
+	*data = (const uint8_t *) block;
+	return sizeof(struct health_block);
+}
+
+/*
+ * @see health.h
+ */
+void health_init() {
+	linkUp = systick_millis();
+	health_update();
+	spicmd_setBlock(SPICMD_BLOCK_HEALTH, healthBlock);
+}
+
+/*
+ * @see health.h
+ */
+void health_loop() {
+	loops++;
+}
+
+/*
+ * @see health.h
+ */
+void health_update() {
+	struct health_block * block = &blocks[published ^ 1];
+	struct event_stats events;
+	struct spicmd_stats link;
+	struct memstat memory;
+	uint16_t isrHits[ISRPROF_VECTORS];
+	
+	event_getStats(&events);
+	isrprof_getHits(isrHits);
+	spicmd_getStats(&link);
+	memstat_get(&memory);
+	
+	block->uptime = systick_millis() / 1000;
+	block->heartbeat = ++heartbeat;
+	block->loopsPerSecond = loops;
+	block->wakeups = events.sleeps;
+	block->spiBytes = link.bytes;
+	block->spiDesyncs = link.desyncs;
+	block->spiQueueFull = link.queueFull;
+	block->workDropped = workqueue_getDropped();
+#if !defined(NO_CONSOLE)
+	block->uartOverruns = uart_getOverruns();
+#else
+	block->uartOverruns = 0;
+#endif
+	block->i2cErrors = i2c_getErrors();
+	block->stackUnused = memory.stackUnused;
+	block->linkUpMs = linkUp;
+	block->firstSpiMs = link.firstByteMs;
+	for (uint8_t i = 0; i < ISRPROF_VECTORS; i++) {
+		block->isrHits[i] = isrHits[i] - lastIsrHits[i];
+		lastIsrHits[i] = isrHits[i];
+	}
+	block->resetCause = resetCause;
+	block->ready = (box_isReady() ? HEALTH_READY_BOX : 0) | (alert_isReady() ? HEALTH_READY_ALERT : 0);
+	block->version = HEALTH_VERSION;
+	
+	loops = 0;
+	published ^= 1;
+}
+
+/*
+ * @see health.h
+ */
+void health_get(struct health_block * block) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		*block = blocks[published];
+	}
+}
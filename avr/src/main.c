@@ -3,6 +3,7 @@
 #include <avr/interrupt.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <avr/pgmspace.h>
 #include "main.h"
 #include "uart.h"
 #include "defineConfig.h"
@@ -16,13 +17,32 @@
 #include "ioctl.h"
 #include "pin_config.h"
 #include "alert.h"
+#include "orientation.h"
+#include "cordic.h"
+#include "cycles.h"
+#include "systick.h"
+#include "timerwheel.h"
+#include "event.h"
+#include "workqueue.h"
+#include "scheduler.h"
+#include "isrprof.h"
+#include "memstat.h"
+#include "trace.h"
+#include "health.h"
 
 #define SERIAL_INPUT_BUFFER_SIZE 32
 
 static void setup();
 static void loop();
-static void processSerialInput(void);
+static void runAlert(void);
+static uint8_t traceBlock(const uint8_t **);
+static uint8_t traceResumeBlock(const uint8_t **);
+#if defined(ISR_PROFILE)
+static uint8_t isrProfileBlock(const uint8_t **);
+#endif
 
+#if !defined(NO_CONSOLE)
+static void processSerialInput(void);
 static void pong(char *);
 static void moveA(char *);
 static void moveB(char *);
@@ -30,8 +50,27 @@ static void readAccel(char *);
 static void sendToBBB(char *);
 static void clearAccelInt(char *);
 static void alertstatus(char *);
+static void vibrationstatus(char *);
+static void tiltstatus(char *);
+static void benchCordic(char *);
+static void calibrate(char *);
+static void calibrationResult(char *);
+static void clearCalibration(char *);
+static void eventStatus(char *);
+static void taskStatus(char *);
+static void clearTaskStats(char *);
+static void memStatus(char *);
+static void healthStatus(char *);
+static void traceDump(char *);
+static void traceResume(char *);
+static void traceMask(char *);
+#if defined(ISR_PROFILE)
+static void isrStatus(char *);
+static void clearIsrStats(char *);
+#endif
 
 static void isOpen();
+static void servoStatus();
 static void bbbOpen();
 static void bbbClose();
 
@@ -39,18 +78,63 @@ static void bbbClose();
  * Lists of UART command vectors used to debug and manually operate
  * the system.
  */
-static struct Command optList[] = {
+static const struct Command optList[] PROGMEM = {
   {"ping", pong, true}, // Alive check and debug
   {"moveA", moveA, true},
   {"moveB", moveB, true},
   {"isOpen", isOpen, false},
+  {"servos", servoStatus, false},
   {"bbbOpen", bbbOpen, false},
   {"bbbClose", bbbClose, false},
   {"sendbbb", sendToBBB, true},
   {"ra", readAccel, false},
   {"cai", clearAccelInt, false},
-  {"alert", alertstatus, false}
+  {"alert", alertstatus, false},
+  {"vib", vibrationstatus, false},
+  {"tilt", tiltstatus, false},
+  {"bcordic", benchCordic, false},
+  {"calib", calibrate, false},
+  {"calibres", calibrationResult, false},
+  {"calibclr", clearCalibration, false},
+  {"events", eventStatus, false},
+  {"tasks", taskStatus, false},
+  {"tasksclr", clearTaskStats, false},
+  {"mem", memStatus, false},
+  {"health", healthStatus, false},
+  {"trace", traceDump, false},
+  {"traceclr", traceResume, false},
+  {"tracemask", traceMask, true},
+#if defined(ISR_PROFILE)
+  {"isr", isrStatus, false},
+  {"isrclr", clearIsrStats, false},
+#endif
 }; 
+#endif /* NO_CONSOLE */
+
+/**
+ * Tasks of the main loop, see scheduler.h.
+ */
+static const char workTask[] PROGMEM = "work";
+static const char timerTask[] PROGMEM = "timer";
+static const char boxTask[] PROGMEM = "box";
+static const char alertTask[] PROGMEM = "alert";
+#if !defined(NO_CONSOLE)
+static const char consoleTask[] PROGMEM = "console";
+#endif
+static const char healthTask[] PROGMEM = "health";
+static const char traceTask[] PROGMEM = "trace";
+
+static struct task taskList[] = {
+	{workTask, workqueue_run, 0, EVENT_WORK, 0},
+	{timerTask, timer_dispatch, 1, EVENT_TIMER, 0},
+	{boxTask, box_handleCurrentState, 2, EVENT_BOX, 0},
+	{alertTask, runAlert, 3, EVENT_BOX | EVENT_ALERT, 0},
+#if !defined(NO_CONSOLE)
+	{consoleTask, processSerialInput, 4, EVENT_UART, 0},
+#endif
+	{healthTask, health_update, 5, 0, HEALTH_PERIOD_MS},
+	{traceTask, trace_tick, 5, 0, 1000}
+};
 
 int main() {
 	setup();
@@ -62,37 +146,101 @@ int main() {
 }
 
 void setup() {
+	// The SPI link and the box state come up first, the BBB can talk to 
+	// the AVR as soon as the interrupts are enabled
+	systick_init();
+#if !defined(NO_CONSOLE)
 	uart_open(UART_BAUD_RATE, UART_DIRECTION, UART_PARITY, UART_FRAME_SIZE, UART_STOPBIT);
+#endif
+	spicmd_init();
+	spicmd_setBlock(SPICMD_BLOCK_TRACE, traceBlock);
+	spicmd_setBlock(SPICMD_BLOCK_TRACE_RESUME, traceResumeBlock);
+	trace_setTrigger(TRACE_BOX_FAULT, TRACE_SIZE / 4);
+#if defined(ISR_PROFILE)
+	isrprof_reset();
+	spicmd_setBlock(SPICMD_BLOCK_ISR_PROFILE, isrProfileBlock);
+#endif
+	box_init();
 	sei();
+	health_init();
 	
-	fprintf(&uartStream, "Init cmd...\n");
+#if !defined(NO_CONSOLE)
 	command_setup(optList, LENGTH_OF_ARRAY(optList));
+	fprintf_P(&uartStream, PSTR("Link up in %"PRIu32" ms\n"), systick_millis());
+#endif
 	
-	fprintf(&uartStream, "Init spicmd...\n");
-	spicmd_init();
-	
-	fprintf(&uartStream, "Init box...\n");
-	box_init();
-		
-	fprintf(&uartStream, "Init i2c...\n");
 	i2c_master_init(I2C_FREQUENCY);
 	
-	fprintf(&uartStream, "Init alert...\n");
+	// The LSM303 settles in the background, see alert_isReady()
 	alert_init();
 	
-	fprintf(&uartStream, "Init global GPIOs...\n");	
 	ioctl_setdir(&LED_ALIVE_DDR, LED_ALIVE_IO, OUTPUT);
 	ioctl_setdir(&ACCEL_INT_DDR, ACCEL_INT_DDR, INPUT); 
 	
-	fprintf(&uartStream, "System ready!\n");
+	scheduler_init(taskList, LENGTH_OF_ARRAY(taskList));
+	
+#if !defined(NO_CONSOLE)
+	fprintf_P(&uartStream, PSTR("System ready in %"PRIu32" ms!\n"), systick_millis());
+#endif
+	
+	// First run of the modules, then only on events
+	event_post(EVENT_BOX | EVENT_ALERT);
 }
 
+/**
+ * Runs the tasks ready on the events posted by the interrupts, the MCU 
+ * sleeps while nothing is pending.
+ */
 void loop() {
-	processSerialInput();
-	box_handleCurrentState();
+	scheduler_run(event_wait());
+	health_loop();
+}
+
+/**
+ * Runs the alert module, it is armed while the box is closed.
+ */
+static void runAlert(void) {
 	alert_run(box_isOpen() ? ALERT_RUN_DISARM : ALERT_RUN_ARMED);
 }
 
+/**
+ * SPI block of the trace, it stays frozen until the BBB resumes it.
+ * 
+ * Called from the SPI interrupt.
+ */
+static uint8_t traceBlock(const uint8_t ** data) {
+	*data = (const uint8_t *) trace_get();
+	return sizeof(struct trace_dump);
+}
+
+/**
+ * Empty SPI block that resumes the trace.
+ * 
+ * Called from the SPI interrupt.
+ */
+static uint8_t traceResumeBlock(const uint8_t ** data) {
+	trace_resume();
+	*data = NULL;
+	return 0;
+}
+
+#if defined(ISR_PROFILE)
+/**
+ * SPI block of the interrupt handler statistics, a snapshot of the
+ * ISRPROF_VECTORS struct isrprof_stats in little endian.
+ * 
+ * Called from the SPI interrupt.
+ */
+static uint8_t isrProfileBlock(const uint8_t ** data) {
+	static struct isrprof_stats snapshot[ISRPROF_VECTORS];
+	
+	isrprof_get(snapshot);
+	*data = (const uint8_t *) snapshot;
+	return sizeof(snapshot);
+}
+#endif
+
+#if !defined(NO_CONSOLE)
 /**
  * Reads the Serial Buffer if an input is available until a newline or the buffer is full, then execute any found commands.
  */
@@ -118,7 +266,7 @@ static void processSerialInput(void) {
  */
 static void sendToBBB(char * arg) {
 	uint8_t i = atoi(arg);
-	fprintf(&uartStream, "sending! %" PRIx8 "\n", i);
+	fprintf_P(&uartStream, PSTR("sending! %" PRIx8 "\n"), i);
 	spicmd_send(i);
 }
 
@@ -126,9 +274,217 @@ static void sendToBBB(char * arg) {
  * Displays the current raw alert status to UART.
  */
 static void alertstatus(char * arg) {
-	fprintf(&uartStream, "Status: %"PRIx8 "\n", alert_getstatus());
+	fprintf_P(&uartStream, PSTR("Status: %"PRIx8 " Profile: %"PRIu8"\n"), alert_getstatus(), alert_getProfile());
+}
+
+/**
+ * Displays the features and class of the last vibration window to UART.
+ */
+static void vibrationstatus(char * arg) {
+	struct vibration_features features;
+	uint8_t cls = alert_getLastClass(&features);
+	
+	fprintf_P(&uartStream, PSTR("Vib: class: %"PRIu8", rms: %"PRIu16" peak: %"PRIu16" tilt: %"PRIu16" zc: %"PRIu8" ff: %"PRIu8"\n"),
+			cls, features.rms, features.peak, features.tiltChange, features.zeroCrossings, features.freefallSamples);
+}
+
+/**
+ * Displays the current and arm time orientation to UART.
+ */
+static void tiltstatus(char * arg) {
+	struct orientation_angles current, reference;
+	bool valid = orientation_get(&current, &reference);
+	
+	fprintf_P(&uartStream, PSTR("Tilt: pitch: %"PRId16" roll: %"PRId16" ref: %d pitch: %"PRId16" roll: %"PRId16"\n"),
+			current.pitch, current.roll, valid, reference.pitch, reference.roll);
 }
 
+/**
+ * Measures the cycles of a cordic_tilt() call on a fixed reading.
+ * 
+ * Every call is timed on its own with cycles.h and the interrupts left
+ * enabled, so the servo pulses and the links are not disturbed. The
+ * minimum of CORDIC_BENCH_RUNS calls is the cost of the kernel, the 
+ * average includes the interrupts that hit the calls.
+ */
+#define CORDIC_BENCH_RUNS (64)
+static void benchCordic(char * arg) {
+	volatile int16_t x = -123, y = 345, z = 456;
+	int16_t pitch, roll;
+	uint32_t total = 0;
+	uint32_t min = UINT32_MAX;
+	
+	for (uint8_t i = 0; i < CORDIC_BENCH_RUNS; i++) {
+		uint16_t start = cycles_now();
+		cordic_tilt(x, y, z, &pitch, &roll);
+		uint32_t elapsed = cycles_elapsed(start);
+		
+		total += elapsed;
+		if (elapsed < min) {
+			min = elapsed;
+		}
+	}
+	
+	fprintf_P(&uartStream, PSTR("cordic_tilt: min %"PRIu32" avg %"PRIu32" cycles (%"PRId16", %"PRId16")\n"),
+			min, total / CORDIC_BENCH_RUNS, pitch, roll);
+}
+
+/**
+ * Starts the alert threshold calibration in the background.
+ * 
+ * The box must be at rest.
+ */
+static void calibrate(char * arg) {
+	if (alert_calibrate()) {
+		fprintf_P(&uartStream, PSTR("Calibrating, -calibres for the result\n"));
+	} else {
+		fprintf_P(&uartStream, PSTR("Calibration busy or alert armed\n"));
+	}
+}
+
+/**
+ * Prints the calibration in use and the status of the last one.
+ */
+static void calibrationResult(char * arg) {
+	struct calibration_result result;
+	int status = alert_getCalibration(&result);
+	
+	fprintf_P(&uartStream, PSTR("Calib: %d ths: %"PRIu8" dur: %"PRIu8"%S\n"), status, result.threshold, result.duration,
+			(result.flags & CALIBRATION_FLAG_DEFAULTS) ? PSTR(" defaults") : PSTR(""));
+	for (uint8_t axis = 0; axis < 3; axis++) {
+		fprintf_P(&uartStream, PSTR(" axis %"PRIu8" mean: %"PRId16" sigma: %"PRIu16"\n"), axis, result.mean[axis], result.sigma[axis]);
+	}
+}
+
+/**
+ * Clears the stored calibration, the next boot will calibrate again.
+ */
+static void clearCalibration(char * arg) {
+	calibration_clear();
+	fprintf_P(&uartStream, PSTR("Calibration cleared\n"));
+}
+
+/**
+ * Displays the sleep count and the wake-up latency of the main loop to UART.
+ */
+static void eventStatus(char * arg) {
+	struct event_stats stats;
+	
+	event_getStats(&stats);
+	fprintf_P(&uartStream, PSTR("Sleeps: %"PRIu32", latency: %"PRIu32" cycles, max: %"PRIu32" cycles\n"), stats.sleeps, stats.lastLatency, stats.maxLatency);
+	fprintf_P(&uartStream, PSTR("Deferred work dropped: %"PRIu16"\n"), workqueue_getDropped());
+}
+
+/**
+ * Displays the run count, average and worst run time of the main loop
+ * tasks to UART.
+ */
+static void taskStatus(char * arg) {
+	fprintf_P(&uartStream, PSTR("Task     prio       runs   avg cycles worst cycles\n"));
+	for (uint8_t i = 0; i < LENGTH_OF_ARRAY(taskList); i++) {
+		struct task * task = &taskList[i];
+		uint32_t average = (task->count != 0) ? task->cycles / task->count : 0;
+		
+		fprintf_P(&uartStream, PSTR("%-8S %4"PRIu8" %10"PRIu32" %12"PRIu32" %12"PRIu32"\n"), 
+				task->name, task->priority, task->count, average, task->worst);
+	}
+}
+
+/**
+ * Clears the statistics of the main loop tasks.
+ */
+static void clearTaskStats(char * arg) {
+	scheduler_resetStats();
+	fprintf_P(&uartStream, PSTR("Task statistics cleared\n"));
+}
+
+/**
+ * Displays the static RAM, the heap and the free and high-water stack
+ * to UART.
+ */
+static void memStatus(char * arg) {
+	struct memstat stat;
+	
+	memstat_get(&stat);
+	fprintf_P(&uartStream, PSTR("RAM: data: %"PRIu16" bss: %"PRIu16" heap: %"PRIu16"\n"), stat.data, stat.bss, stat.heap);
+	fprintf_P(&uartStream, PSTR("Stack: free: %"PRIu16" never used: %"PRIu16" peak: %"PRIu16"\n"), stat.stackFree, stat.stackUnused, stat.stackPeak);
+}
+
+/**
+ * Displays the health counters served to the BBB to UART.
+ */
+static void healthStatus(char * arg) {
+	struct health_block block;
+	
+	health_get(&block);
+	fprintf_P(&uartStream, PSTR("Uptime: %"PRIu32" s, heartbeat: %"PRIu16", loops/s: %"PRIu16", wakeups: %"PRIu32", reset: %02"PRIx8"\n"),
+			block.uptime, block.heartbeat, block.loopsPerSecond, block.wakeups, block.resetCause);
+	fprintf_P(&uartStream, PSTR("SPI: bytes: %"PRIu32" desyncs: %"PRIu16" queue full: %"PRIu16"\n"), block.spiBytes, block.spiDesyncs, block.spiQueueFull);
+	fprintf_P(&uartStream, PSTR("Dropped: work: %"PRIu16" uart: %"PRIu16", i2c errors: %"PRIu16", stack unused: %"PRIu16"\n"),
+			block.workDropped, block.uartOverruns, block.i2cErrors, block.stackUnused);
+	fprintf_P(&uartStream, PSTR("Boot: link up: %"PRIu16" ms, first SPI byte: %"PRIu16" ms, ready: %02"PRIx8"\n"),
+			block.linkUpMs, block.firstSpiMs, block.ready);
+}
+
+/**
+ * Freezes and dumps the trace to UART in hex, decoded by
+ * bbb/avr_diag.py. "traceclr" resumes the trace.
+ */
+static void traceDump(char * arg) {
+	const uint8_t * data = (const uint8_t *) trace_get();
+	
+	fprintf_P(&uartStream, PSTR("TRACE %u\n"), (unsigned) sizeof(struct trace_dump));
+	for (uint8_t i = 0; i < sizeof(struct trace_dump); i++) {
+		fprintf_P(&uartStream, PSTR("%02"PRIx8"%c"), data[i], (i % 16 == 15) ? '\n' : ' ');
+	}
+	fprintf_P(&uartStream, PSTR("\nTRACE END\n"));
+}
+
+/**
+ * Empties the trace and starts recording again.
+ */
+static void traceResume(char * arg) {
+	trace_resume();
+	fprintf_P(&uartStream, PSTR("Trace resumed\n"));
+}
+
+/**
+ * Selects the recorded trace groups, a hex mask of TRACE_GROUP(id).
+ */
+static void traceMask(char * arg) {
+	if (arg != NULL) {
+		trace_setMask(strtoul(arg, NULL, 16));
+	}
+}
+
+#if defined(ISR_PROFILE)
+/**
+ * Displays the hit count and the min, average and max cycles of the 
+ * interrupt handlers to UART.
+ */
+static void isrStatus(char * arg) {
+	struct isrprof_stats stats[ISRPROF_VECTORS];
+	
+	isrprof_get(stats);
+	fprintf_P(&uartStream, PSTR("Vector             hits   min   avg   max cycles (+%d)\n"), ISR_PROFILE_OVERHEAD);
+	for (uint8_t i = 0; i < ISRPROF_VECTORS; i++) {
+		uint32_t average = (stats[i].count != 0) ? stats[i].total / stats[i].count : 0;
+		
+		fprintf_P(&uartStream, PSTR("%-12S %10"PRIu32" %5"PRIu16" %5"PRIu32" %5"PRIu16"\n"), 
+				isrprof_getName(i), stats[i].count, stats[i].min, average, stats[i].max);
+	}
+}
+
+/**
+ * Clears the statistics of the interrupt handlers.
+ */
+static void clearIsrStats(char * arg) {
+	isrprof_reset();
+	fprintf_P(&uartStream, PSTR("ISR statistics cleared\n"));
+}
+
+#endif
+
 /**
  * Reads and displays the accelerometer reading to UART.
  */
@@ -136,7 +492,7 @@ static void readAccel(char * arg) {
 	struct lsm303_accel_reading reading;
 	
 	lsm303_read(&reading);
-	fprintf(&uartStream, "Accel: status: %"PRIx8", x: %"PRId16" y: %"PRId16" z: %"PRId16"\n", reading.rawStatus, reading.x, reading.y, reading.z); 
+	fprintf_P(&uartStream, PSTR("Accel: status: %"PRIx8", x: %"PRId16" y: %"PRId16" z: %"PRId16"\n"), reading.rawStatus, reading.x, reading.y, reading.z); 
 }
 
 
@@ -146,7 +502,7 @@ static void readAccel(char * arg) {
 static void clearAccelInt(char * arg) {
 	uint8_t src = lsm303_clear_latched_interrupt();
 	
-	fprintf(&uartStream, "Int SRC: %"PRIx8"\n", src);
+	fprintf_P(&uartStream, PSTR("Int SRC: %"PRIx8"\n"), src);
 }
 
 
@@ -155,7 +511,7 @@ static void clearAccelInt(char * arg) {
  */
 static void pong(char * arg) {
 	uint8_t i = atoi(arg);
-	fprintf(&uartStream, "Pong! %" PRIu8 "\n", i);
+	fprintf_P(&uartStream, PSTR("Pong! %" PRIu8 "\n"), i);
 }
 
 /**
@@ -163,8 +519,8 @@ static void pong(char * arg) {
  */
 static void moveA(char * arg) {
 	int i = atoi(arg);
-	fprintf(&uartStream, " Moving Servo A %d\n", i);
-	servo_write(SERVO_CHANNELA, i);
+	fprintf_P(&uartStream, PSTR(" Moving Servo A %d\n"), i);
+	servo_write(SERVO_CHANNELA, SERVO_DEGREES(i));
 }
 
 /**
@@ -172,18 +528,30 @@ static void moveA(char * arg) {
  */
 static void moveB(char * arg) {
 	int i = atoi(arg);
-	fprintf(&uartStream, " Moving Servo B %d\n", i);
-	servo_write(SERVO_CHANNELB, i);
+	fprintf_P(&uartStream, PSTR(" Moving Servo B %d\n"), i);
+	servo_write(SERVO_CHANNELB, SERVO_DEGREES(i));
 }
 
 /**
  * Prints to UART if the box is opened.
  */
 static void isOpen() {
-	fprintf(&uartStream, "Is switch open? %d\n", box_isOpen());
+	fprintf_P(&uartStream, PSTR("Is switch open? %d\n"), box_isOpen());
 	// spicmd_callback_checkstatus();
 }
 
+/**
+ * Prints to UART the last commanded angle of the servos and whether 
+ * they are attached.
+ */
+static void servoStatus() {
+	for (int channel = SERVO_CHANNELA; channel <= SERVO_CHANNELB; channel++) {
+		int angle = servo_read(channel);
+		fprintf_P(&uartStream, PSTR("Servo %c: %d.%d deg %S\n"), 'A' + channel, angle / 10, angle % 10,
+				servo_isAttached(channel) ? PSTR("attached") : PSTR("detached"));
+	}
+}
+
 /**
  * Unlocks and opens the box.
  */
@@ -197,3 +565,4 @@ static void bbbOpen() {
 static void bbbClose() {
 	spicmd_callback_closelock();
 }
+#endif /* NO_CONSOLE */
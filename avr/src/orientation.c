@@ -0,0 +1,74 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include "orientation.h"
+#include "cordic.h"
+
+static struct orientation_angles reference;
+static struct orientation_angles current;
+static bool referenceValid = false;
+static uint16_t movedTime = 0;
+
+/**
+ * Difference between two angles wrapped to -180..180 degrees.
+ * 
+ * @param a Angle in tenths of a degree
+ * @param b Angle in tenths of a degree
+ * @return Absolute difference in tenths of a degree
+ */
+static uint16_t angleDifference(int16_t a, int16_t b) {
+	int16_t diff = a - b;
+	
+	if (diff > CORDIC_ANGLE_180) {
+		diff -= 2 * CORDIC_ANGLE_180;
+	} else if (diff < -CORDIC_ANGLE_180) {
+		diff += 2 * CORDIC_ANGLE_180;
+	}
+	return abs(diff);
+}
+
+/*
+ * @see orientation.h
+ */
+void orientation_reset() {
+	referenceValid = false;
+	movedTime = 0;
+}
+
+/*
+ * @see orientation.h
+ */
+bool orientation_update(int16_t x, int16_t y, int16_t z, uint8_t period) {
+	cordic_tilt(x, y, z, &current.pitch, &current.roll);
+	
+	if (!referenceValid) {
+		reference = current;
+		referenceValid = true;
+		return false;
+	}
+	
+	if (angleDifference(current.pitch, reference.pitch) > ORIENTATION_MOVED_THRESHOLD
+			|| angleDifference(current.roll, reference.roll) > ORIENTATION_MOVED_THRESHOLD) {
+		if (movedTime < ORIENTATION_MOVED_MS) {
+			movedTime += period;
+		}
+	} else {
+		movedTime = 0;
+	}
+	
+	return movedTime >= ORIENTATION_MOVED_MS;
+}
+
+/*
+ * @see orientation.h
+ */
+bool orientation_get(struct orientation_angles * cur, struct orientation_angles * ref) {
+	if (cur != NULL) {
+		*cur = current;
+	}
+	if (ref != NULL) {
+		*ref = reference;
+	}
+	return referenceValid;
+}
@@ -7,10 +7,13 @@
 #include "pin_config.h"
 #include "spi.h"
 #include "ioctl.h"
+#include "trace.h"
+#include "systick.h"
 
 #define STATE_OFF 			(0)
 #define STATE_WAIT 			(1)
 #define STATE_CMD_SENT 		(2)
+#define STATE_BLOCK 		(3)
 #define STATE_ACKED 		(6)
 
 #define CMD_IN_UNLOCK_OPEN 	(0xA1)
@@ -21,11 +24,17 @@
 
 typedef uint8_t State;
 
+struct block {
+	uint8_t cmd;
+	uint8_t (*open)(const uint8_t ** data);
+};
+
 static void spiVector(void);
 static void pullLowFromTriState(void);
 static void prepareWaitingCommand(void);
 static int addToBuffer(uint8_t c);
 static void checkAndCallVector(uint8_t cmd);
+static bool openBlock(uint8_t cmd);
 
 static uint8_t outputBuffer[OUTPUT_BUFFER_SIZE];
 static volatile size_t outputBufferHead = 0;
@@ -33,6 +42,13 @@ static volatile size_t outputBufferTail = 0;
 
 static volatile State state = STATE_OFF; 
 
+static struct block blocks[SPICMD_BLOCK_MAX];
+static uint8_t blockCount = 0;
+static const uint8_t * blockData;
+static uint8_t blockRemaining = 0;
+
+static struct spicmd_stats linkStats;
+
 static inline bool commandBufferIsEmpty() {
 	return outputBufferHead == outputBufferTail;
 }
@@ -52,11 +68,37 @@ int spicmd_init() {
  * @see spi_command.h
  */
 int spicmd_send(uint8_t cmd) {
+	trace(TRACE_SPICMD_SEND, cmd);
 	int status = addToBuffer(cmd);
 	pullLowFromTriState();
 	return status;
 }
 
+/**
+ * @see spi_command.h
+ */
+int spicmd_setBlock(uint8_t cmd, uint8_t (*open)(const uint8_t ** data)) {
+	if (blockCount >= SPICMD_BLOCK_MAX) {
+		return SPICMD_ERR_BUSY;
+	}
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		blocks[blockCount].cmd = cmd;
+		blocks[blockCount].open = open;
+		blockCount++;
+	}
+	return SPICMD_OK;
+}
+
+/**
+ * @see spi_command.h
+ */
+void spicmd_getStats(struct spicmd_stats * stats) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		*stats = linkStats;
+	}
+}
+
 /**
  * Pull the BBB Status GPIO low from the tri state mode.
  * 
@@ -80,6 +122,9 @@ static int addToBuffer(uint8_t c) {
 
 	// Fail if buffer is full
 	if (i == outputBufferTail) {
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+			linkStats.queueFull++;
+		}
 		return SPICMD_ERR_BUSY;
 	}
 
@@ -102,6 +147,12 @@ static int addToBuffer(uint8_t c) {
 static void spiVector() {
 	uint8_t recv = 0;
 	
+	if (linkStats.bytes++ == 0) {
+		// Time to the first exchange after reset, the systick starts first
+		uint32_t now = systick_millis();
+		linkStats.firstByteMs = (now > UINT16_MAX) ? UINT16_MAX : now;
+	}
+	
 	switch (state) {
 		// We just sent a cmd, this is the shift event from the master
 		// Go back to waiting in tristate if no other commands are available
@@ -114,12 +165,22 @@ static void spiVector() {
 			state = STATE_WAIT;
 			break;
 		
+		// Shift of the size or of a byte of a block, the master sends dummies
+		case STATE_BLOCK:
+			if (blockRemaining > 0) {
+				spi_write_async(*blockData++);
+				blockRemaining--;
+			} else {
+				state = STATE_WAIT;
+			}
+			break;
+		
 		// New Command from SPI
 		case STATE_WAIT:
 			spi_read_async(&recv);
 			if (recv == CMD_IN_GET_STATUS) {
 				prepareWaitingCommand();
-			} else {
+			} else if (!openBlock(recv)) {
 				checkAndCallVector(recv);
 			}
 			break;
@@ -146,6 +207,24 @@ static void prepareWaitingCommand() {
 	}
 }
 
+/**
+ * Starts the shift of a block if the command is registered.
+ * 
+ * @param cmd The byte command received from the SPI interface.
+ * @return true if the command is a block
+ */
+static bool openBlock(uint8_t cmd) {
+	for (uint8_t i = 0; i < blockCount; i++) {
+		if (blocks[i].cmd == cmd) {
+			blockRemaining = blocks[i].open(&blockData);
+			spi_write_async(blockRemaining);
+			state = STATE_BLOCK;
+			return true;
+		}
+	}
+	return false;
+}
+
 /**
  * Validates the command received from the SPI interface.
  * 
@@ -171,6 +250,9 @@ static void checkAndCallVector(uint8_t cmd) {
 		spi_write_async(SPICMD_ACK);
 		vector();
 	} else {
+		if (cmd != 0) {
+			linkStats.desyncs++;
+		}
 		spi_write_async(SPICMD_NACK);
 	}
 }
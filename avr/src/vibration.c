@@ -0,0 +1,137 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "vibration.h"
+#include "cordic.h"
+
+#define AXIS_COUNT		(3)
+
+// Fractional bits of the gravity estimate
+#define GRAVITY_FRAC	(8)
+
+static int32_t gravity[AXIS_COUNT];
+static int16_t gravityStart[AXIS_COUNT];
+static int8_t lastSign[AXIS_COUNT];
+
+static uint32_t energy;
+static uint16_t peak;
+static uint8_t zeroCrossings;
+static uint8_t freefallSamples;
+static uint16_t sampleCount;
+
+/*
+ * @see vibration.h
+ */
+void vibration_reset() {
+	energy = 0;
+	peak = 0;
+	zeroCrossings = 0;
+	freefallSamples = 0;
+	sampleCount = 0;
+}
+
+/**
+ * Updates the gravity estimate, returns the high-passed value and counts
+ * zero-crossings for one axis.
+ *
+ * @param axis Index of the axis
+ * @param value Raw reading of the axis
+ * @return The high-passed value
+ */
+static inline int16_t filterAxis(uint8_t axis, int16_t value) {
+	if (sampleCount == 0) {
+		gravity[axis] = (int32_t) value << GRAVITY_FRAC;
+		gravityStart[axis] = value;
+		lastSign[axis] = 0;
+	} else {
+		gravity[axis] += (((int32_t) value << GRAVITY_FRAC) - gravity[axis]) >> VIBRATION_HPF_SHIFT;
+	}
+
+	int16_t hp = value - (int16_t) (gravity[axis] >> GRAVITY_FRAC);
+
+	// Sign change with hysteresis so the noise floor doesn't count as crossings
+	if (hp > VIBRATION_ZC_HYSTERESIS) {
+		if (lastSign[axis] < 0 && zeroCrossings < UINT8_MAX) {
+			zeroCrossings++;
+		}
+		lastSign[axis] = 1;
+	} else if (hp < -VIBRATION_ZC_HYSTERESIS) {
+		if (lastSign[axis] > 0 && zeroCrossings < UINT8_MAX) {
+			zeroCrossings++;
+		}
+		lastSign[axis] = -1;
+	}
+
+	return hp;
+}
+
+/*
+ * @see vibration.h
+ */
+bool vibration_addSample(int16_t x, int16_t y, int16_t z) {
+	int16_t raw[AXIS_COUNT] = {x, y, z};
+	uint16_t l1 = 0;
+
+	for (uint8_t axis = 0; axis < AXIS_COUNT; axis++) {
+		int16_t hp = filterAxis(axis, raw[axis]);
+		uint16_t mag = abs(hp);
+
+		energy += (uint32_t) ((int32_t) hp * hp) >> VIBRATION_ENERGY_SHIFT;
+		if (mag > peak) {
+			peak = mag;
+		}
+		l1 += abs(raw[axis]);
+	}
+
+	if (l1 < VIBRATION_FREEFALL_L1 && freefallSamples < UINT8_MAX) {
+		freefallSamples++;
+	}
+
+	sampleCount++;
+	return sampleCount >= VIBRATION_WINDOW_SIZE;
+}
+
+/*
+ * @see vibration.h
+ */
+void vibration_getFeatures(struct vibration_features * features) {
+	uint16_t tilt = 0;
+	for (uint8_t axis = 0; axis < AXIS_COUNT; axis++) {
+		tilt += abs((int16_t) (gravity[axis] >> GRAVITY_FRAC) - gravityStart[axis]);
+	}
+
+	features->rms = cordic_sqrt(energy >> (VIBRATION_WINDOW_SHIFT - VIBRATION_ENERGY_SHIFT));
+	features->peak = peak;
+	features->tiltChange = tilt;
+	features->zeroCrossings = zeroCrossings;
+	features->freefallSamples = freefallSamples;
+}
+
+/*
+ * @see vibration.h
+ */
+enum vibration_class vibration_classify(const struct vibration_features * features) {
+	// Free-fall followed by an impact
+	if (features->freefallSamples >= VIBRATION_DROP_MIN_FREEFALL
+			&& features->peak >= VIBRATION_DROP_MIN_PEAK) {
+		return VIBRATION_CLASS_DROP;
+	}
+
+	// Smooth change of the gravity vector, the box is being moved
+	if (features->tiltChange >= VIBRATION_LIFT_MIN_TILT
+			&& features->zeroCrossings <= VIBRATION_LIFT_MAX_ZC) {
+		return VIBRATION_CLASS_LIFT;
+	}
+
+	// Sustained energy: low crest factor (peak/rms) unlike a single knock
+	if (features->rms >= VIBRATION_PRY_MIN_RMS
+			&& features->peak <= (uint32_t) features->rms * VIBRATION_PRY_MAX_CREST) {
+		return VIBRATION_CLASS_PRY;
+	}
+
+	if (features->peak > VIBRATION_ZC_HYSTERESIS) {
+		return VIBRATION_CLASS_BUMP;
+	}
+
+	return VIBRATION_CLASS_NONE;
+}
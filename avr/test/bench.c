@@ -0,0 +1,102 @@
+/*
+ * Host microbenchmarks of the parser, the ring buffers and the SPI 
+ * protocol. The times are host nanoseconds, they compare two versions 
+ * of the code and say nothing of the cycles on the AVR.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include "hal.h"
+#include "command.h"
+#include "uart.h"
+#include "spi_command.h"
+#include "workqueue.h"
+#include "trace.h"
+#include "event.h"
+#include "defineConfig.h"
+
+#define BENCH_RUNS		(200000)
+
+static volatile uint32_t sink;
+
+static void nop(char * arg) {
+	sink++;
+}
+
+static void work(void * arg) {
+	sink++;
+}
+
+static const struct Command optList[] PROGMEM = {
+	{"ping", nop, true},
+	{"moveA", nop, true},
+	{"status", nop, false},
+	{"tasks", nop, false},
+	{"health", nop, false},
+};
+
+static void benchCommand(void) {
+	char line[32];
+	
+	strcpy(line, "CMD -health -ping 42");
+	command_execute(line, NULL);
+}
+
+static void benchUart(void) {
+	uart_write('x', NULL);
+	hal_interrupt(USART_UDRE_vect);
+}
+
+static void benchSpiStatus(void) {
+	SPDR = 0xC1;
+	hal_interrupt(SPI_STC_vect);
+	SPDR = 0;
+	hal_interrupt(SPI_STC_vect);
+}
+
+static void benchTrace(void) {
+	trace(TRACE_MARK, 0);
+}
+
+static void benchWorkqueue(void) {
+	workqueue_post(work, NULL);
+	workqueue_run();
+}
+
+/**
+ * Prints the average time of a call.
+ */
+static void bench(const char * name, void (*run)(void)) {
+	struct timespec start, end;
+	
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (uint32_t i = 0; i < BENCH_RUNS; i++) {
+		run();
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	
+	double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+	printf("%-24s %8.1f ns\n", name, ns / BENCH_RUNS);
+}
+
+int main() {
+	hal_reset();
+	command_setup(optList, LENGTH_OF_ARRAY(optList));
+	uart_open(9600, UART_DIRECTION_RXTX, UART_PARITY_NONE, UART_FRAME_SIZE_8BIT, UART_STOP_1BIT);
+	spicmd_init();
+	trace_setMask(0);
+	
+	bench("command_execute", benchCommand);
+	bench("uart_write + UDRE", benchUart);
+	bench("spi_command status", benchSpiStatus);
+	bench("workqueue post + run", benchWorkqueue);
+	trace_setMask(0xFF);
+	bench("trace", benchTrace);
+	return 0;
+}
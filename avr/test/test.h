@@ -0,0 +1,65 @@
+/**
+ * Minimal unit test harness of the host tests, see host/hal.h.
+ * 
+ * Usage:
+ * 		static void test_something(void) {
+ * 			TEST_EQUAL(3, 1 + 2);
+ * 		}
+ * 
+ * 		int main() {
+ * 			TEST_RUN(test_something);
+ * 			return test_report("example");
+ * 		}
+ * 
+ * A failed check ends the test, the next one is run.
+ */
+
+#ifndef _TEST_H
+#define _TEST_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+static int testCount = 0;
+static int testFailures = 0;
+static bool testFailed;
+
+#define TEST_ASSERT(cond) do { \
+		if (!(cond)) { \
+			printf("  %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+			testFailed = true; \
+			return; \
+		} \
+	} while (0)
+
+#define TEST_EQUAL(expected, actual) do { \
+		long long _expected = (long long) (expected); \
+		long long _actual = (long long) (actual); \
+		if (_expected != _actual) { \
+			printf("  %s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, _actual, _expected); \
+			testFailed = true; \
+			return; \
+		} \
+	} while (0)
+
+#define TEST_RUN(test) do { \
+		testFailed = false; \
+		test(); \
+		testCount++; \
+		if (testFailed) { \
+			testFailures++; \
+			printf("FAIL %s\n", #test); \
+		} \
+	} while (0)
+
+/**
+ * Prints the summary of the test program.
+ * 
+ * @return The exit code, 0 if every test passed
+ */
+static inline int test_report(const char * name) {
+	printf("%s: %d tests, %d failed\n", name, testCount, testFailures);
+	return testFailures != 0;
+}
+
+#endif /* _TEST_H */
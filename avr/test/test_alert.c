@@ -0,0 +1,183 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/twi.h>
+#include "test.h"
+#include "hal.h"
+#include "i2c.h"
+#include "systick.h"
+#include "timerwheel.h"
+#include "workqueue.h"
+#include "spi_command.h"
+#include "alert.h"
+#include "orientation.h"
+
+// Private states of alert.c
+#define STATE_ARMED			(ALERT_RUN_ARMED)
+#define STATE_INTRUDER		(3)
+#define STATE_CLASSIFYING	(4)
+
+#define LSM303_ADDR8		(0x32)
+#define AUTO_INCREMENT		(0x80)
+#define STATUS_REG_A		(0x27)
+#define OUT_X_L_A			(0x28)
+#define STATUS_ZYXDA		(0x08)
+
+// 1g at LSM303_FS_4G, 2mg/LSB
+#define ONE_G				(500)
+// 1g tilted by 45 degrees
+#define ONE_G_45			(354)
+
+enum phase {
+	PHASE_IDLE,
+	PHASE_ADDRESS,
+	PHASE_REGISTER,
+	PHASE_WRITE,
+	PHASE_READ
+};
+
+/*
+ * LSM303 accelerometer on the bus, every read of the status register
+ * has a new sample of the current acceleration.
+ */
+static uint8_t deviceRegs[0x80];
+static uint8_t pointer;
+static uint8_t written;
+static enum phase phase = PHASE_IDLE;
+
+static void setAcceleration(int16_t x, int16_t y, int16_t z) {
+	int16_t axes[] = {x, y, z};
+
+	for (uint8_t i = 0; i < 3; i++) {
+		// Left aligned 12 bit
+		uint16_t raw = (uint16_t) axes[i] << 4;
+		deviceRegs[OUT_X_L_A + 2 * i] = raw & 0xFF;
+		deviceRegs[OUT_X_L_A + 2 * i + 1] = raw >> 8;
+	}
+	deviceRegs[STATUS_REG_A] = STATUS_ZYXDA;
+}
+
+/**
+ * Poll hook, runs the operation the driver started by writing TWCR and
+ * sets the status of the TWI master.
+ * 
+ * The STOP is not polled by the driver, a START is a repeated start only
+ * right after the register byte of a read.
+ */
+static void twiModel(void) {
+	uint8_t control = TWCR;
+
+	if (control & _BV(TWSTA)) {
+		TWSR = (phase == PHASE_WRITE && written == 0) ? TW_REP_START : TW_START;
+		phase = PHASE_ADDRESS;
+		return;
+	}
+
+	switch (phase) {
+		case PHASE_ADDRESS:
+			if ((TWDR & ~TW_READ) != LSM303_ADDR8) {
+				TWSR = TW_MT_SLA_NACK;
+			} else if (TWDR & TW_READ) {
+				TWSR = TW_MR_SLA_ACK;
+				phase = PHASE_READ;
+			} else {
+				TWSR = TW_MT_SLA_ACK;
+				phase = PHASE_REGISTER;
+			}
+			break;
+		case PHASE_REGISTER:
+			pointer = TWDR & ~AUTO_INCREMENT;
+			written = 0;
+			TWSR = TW_MT_DATA_ACK;
+			phase = PHASE_WRITE;
+			break;
+		case PHASE_WRITE:
+			deviceRegs[pointer++ % sizeof(deviceRegs)] = TWDR;
+			written++;
+			TWSR = TW_MT_DATA_ACK;
+			break;
+		case PHASE_READ:
+			TWDR = deviceRegs[pointer++ % sizeof(deviceRegs)];
+			TWSR = (control & _BV(TWEA)) ? TW_MR_DATA_ACK : TW_MR_DATA_NACK;
+			break;
+		case PHASE_IDLE:
+			break;
+	}
+}
+
+static uint8_t runStatus = ALERT_RUN_DISARM;
+
+/**
+ * Main loop for a number of systick ticks.
+ */
+static void runFor(uint16_t ms) {
+	for (uint16_t i = 0; i < ms; i++) {
+		hal_interrupt(TIMER0_COMPA_vect);
+		timer_dispatch();
+		workqueue_run();
+		alert_run(runStatus);
+	}
+}
+
+static void test_init(void) {
+	hal_reset();
+	hal_setPollHook(twiModel);
+	systick_init();
+	spicmd_init();
+	i2c_master_init(400000);
+	setAcceleration(0, 0, ONE_G);
+
+	alert_init();
+	TEST_ASSERT(!alert_isReady());
+
+	// Boot calibration on the flat box
+	runFor(2000);
+	TEST_ASSERT(alert_isReady());
+
+	runStatus = ALERT_RUN_ARMED;
+	runFor(50);
+	TEST_EQUAL(STATE_ARMED, alert_getstatus());
+	TEST_EQUAL(ALERT_PROFILE_ARMED, alert_getProfile());
+}
+
+static void test_shockTiltDuringClassification(void) {
+	// Threshold interrupt of a shock
+	hal_interrupt(INT0_vect);
+	runFor(10);
+	TEST_EQUAL(STATE_CLASSIFYING, alert_getstatus());
+	TEST_EQUAL(ALERT_PROFILE_FORENSIC, alert_getProfile());
+
+	// The acceleration of the shock tilts the gravity vector for 40ms
+	setAcceleration(ONE_G_45, 0, ONE_G_45);
+	runFor(40);
+	TEST_EQUAL(STATE_CLASSIFYING, alert_getstatus());
+
+	// The window is classified, not cut short by the orientation
+	setAcceleration(0, 0, ONE_G);
+	runFor(600);
+	TEST_ASSERT(alert_getLastClass(NULL) != VIBRATION_CLASS_NONE);
+	TEST_ASSERT(alert_getstatus() != STATE_CLASSIFYING);
+}
+
+static void test_tiltWhileArmed(void) {
+	// Wait for the end of the quiet period if the shock was an intrusion
+	runFor(ALERT_QUIET_PERIOD_MS + 100);
+	TEST_EQUAL(STATE_ARMED, alert_getstatus());
+
+	setAcceleration(ONE_G_45, 0, ONE_G_45);
+	runFor(ORIENTATION_MOVED_MS - 2 * ALERT_ARMED_SAMPLE_MS);
+	TEST_EQUAL(STATE_ARMED, alert_getstatus());
+
+	runFor(3 * ALERT_ARMED_SAMPLE_MS);
+	TEST_EQUAL(STATE_INTRUDER, alert_getstatus());
+	setAcceleration(0, 0, ONE_G);
+}
+
+int main() {
+	TEST_RUN(test_init);
+	TEST_RUN(test_shockTiltDuringClassification);
+	TEST_RUN(test_tiltWhileArmed);
+	return test_report("alert");
+}
@@ -0,0 +1,127 @@
+#include <string.h>
+#include <stddef.h>
+#include <avr/pgmspace.h>
+#include "test.h"
+#include "command.h"
+#include "defineConfig.h"
+
+static int pingCount;
+static char pingArg[16];
+static int statusCount;
+static char echoName[COMMAND_OPT_MAX];
+static char echoArg[16];
+
+static void ping(char * arg) {
+	pingCount++;
+	strcpy(pingArg, arg != NULL ? arg : "");
+}
+
+static void status(char * arg) {
+	statusCount++;
+}
+
+static void echo(char * name, char * arg) {
+	strcpy(echoName, name);
+	strcpy(echoArg, arg != NULL ? arg : "");
+}
+
+static const struct Command optList[] PROGMEM = {
+	{"ping", ping, true},
+	{"status", status, false},
+};
+
+static void setup(void) {
+	pingCount = 0;
+	statusCount = 0;
+	pingArg[0] = '\0';
+	echoName[0] = '\0';
+	command_setup(optList, LENGTH_OF_ARRAY(optList));
+}
+
+static void test_prefixRequired(void) {
+	char line[] = "ping -ping 1";
+	
+	setup();
+	TEST_EQUAL(-1, command_execute(line, NULL));
+	TEST_EQUAL(0, pingCount);
+}
+
+static void test_commandWithArg(void) {
+	char line[] = "CMD -ping 42";
+	
+	setup();
+	TEST_EQUAL(1, command_execute(line, NULL));
+	TEST_EQUAL(1, pingCount);
+	TEST_ASSERT(strcmp(pingArg, "42") == 0);
+}
+
+static void test_commandWithoutArg(void) {
+	char line[] = "CMD -status";
+	
+	setup();
+	command_execute(line, NULL);
+	TEST_EQUAL(1, statusCount);
+	TEST_EQUAL(0, pingCount);
+}
+
+static void test_severalCommands(void) {
+	char line[] = "CMD -status -ping 7 -status";
+	
+	setup();
+	command_execute(line, NULL);
+	TEST_EQUAL(2, statusCount);
+	TEST_EQUAL(1, pingCount);
+	TEST_ASSERT(strcmp(pingArg, "7") == 0);
+}
+
+static void test_missingArgIsNull(void) {
+	char line[] = "CMD -ping";
+	
+	setup();
+	strcpy(pingArg, "unset");
+	command_execute(line, NULL);
+	TEST_EQUAL(1, pingCount);
+	TEST_ASSERT(strcmp(pingArg, "") == 0);
+}
+
+static void test_unknownIgnored(void) {
+	char line[] = "CMD -pong 1 status -stat -status";
+	
+	setup();
+	TEST_EQUAL(1, command_execute(line, NULL));
+	TEST_EQUAL(0, pingCount);
+	TEST_EQUAL(1, statusCount);
+}
+
+static void test_echo(void) {
+	char line[] = "CMD -ping 3";
+	
+	setup();
+	command_execute(line, echo);
+	TEST_ASSERT(strcmp(echoName, "ping") == 0);
+	TEST_ASSERT(strcmp(echoArg, "3") == 0);
+}
+
+static void test_tooManyTokens(void) {
+	char line[16 + (COMMAND_INPUT_ARG_MAX + 4) * 8] = "CMD";
+	
+	setup();
+	for (int i = 0; i < COMMAND_INPUT_ARG_MAX + 4; i++) {
+		strcat(line, " -status");
+	}
+	command_execute(line, NULL);
+	// The prefix is the first token
+	TEST_EQUAL(COMMAND_INPUT_ARG_MAX - 1, statusCount);
+}
+
+int main() {
+	TEST_RUN(test_prefixRequired);
+	TEST_RUN(test_commandWithArg);
+	TEST_RUN(test_commandWithoutArg);
+	TEST_RUN(test_severalCommands);
+	TEST_RUN(test_missingArgIsNull);
+	TEST_RUN(test_unknownIgnored);
+	TEST_RUN(test_echo);
+	TEST_RUN(test_tooManyTokens);
+	return test_report("command");
+}
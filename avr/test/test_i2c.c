@@ -0,0 +1,187 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/twi.h>
+#include "test.h"
+#include "hal.h"
+#include "i2c.h"
+
+#define DEVICE_ADDR8	(0x32)
+#define AUTO_INCREMENT	(0x80)
+
+enum phase {
+	PHASE_IDLE,
+	PHASE_ADDRESS,
+	PHASE_REGISTER,
+	PHASE_WRITE,
+	PHASE_READ
+};
+
+/*
+ * Register device on the bus, with the register auto-increment of the
+ * LSM303.
+ */
+static uint8_t deviceRegs[0x80];
+static uint8_t pointer;
+static enum phase phase;
+static bool busError;
+
+static void deviceReset(void) {
+	phase = PHASE_IDLE;
+	busError = false;
+}
+
+/**
+ * Poll hook, runs the operation the driver started by writing TWCR and 
+ * sets the status of the TWI master.
+ */
+static void twiModel(void) {
+	uint8_t control = TWCR;
+	
+	if (control & _BV(TWSTA)) {
+		if (busError) {
+			TWSR = TW_BUS_ERROR;
+		} else {
+			TWSR = (phase == PHASE_IDLE) ? TW_START : TW_REP_START;
+		}
+		phase = PHASE_ADDRESS;
+		return;
+	}
+	
+	switch (phase) {
+		case PHASE_ADDRESS:
+			if ((TWDR & ~TW_READ) != DEVICE_ADDR8) {
+				TWSR = TW_MT_SLA_NACK;
+			} else if (TWDR & TW_READ) {
+				TWSR = TW_MR_SLA_ACK;
+				phase = PHASE_READ;
+			} else {
+				TWSR = TW_MT_SLA_ACK;
+				phase = PHASE_REGISTER;
+			}
+			break;
+		case PHASE_REGISTER:
+			pointer = TWDR & ~AUTO_INCREMENT;
+			TWSR = TW_MT_DATA_ACK;
+			phase = PHASE_WRITE;
+			break;
+		case PHASE_WRITE:
+			deviceRegs[pointer++ % sizeof(deviceRegs)] = TWDR;
+			TWSR = TW_MT_DATA_ACK;
+			break;
+		case PHASE_READ:
+			TWDR = deviceRegs[pointer++ % sizeof(deviceRegs)];
+			TWSR = (control & _BV(TWEA)) ? TW_MR_DATA_ACK : TW_MR_DATA_NACK;
+			break;
+		case PHASE_IDLE:
+			break;
+	}
+}
+
+static int slaveReads = 0;
+
+static void slaveRead(void) {
+	slaveReads++;
+}
+
+static void test_init(void) {
+	hal_reset();
+	hal_setPollHook(twiModel);
+	i2c_master_init(50000);
+	
+	// 16 MHz / (16 + 2 * TWBR) = 50 kHz
+	TEST_EQUAL(152, TWBR);
+	TEST_ASSERT(bit_is_set(TWCR, TWEN));
+}
+
+static void test_write(void) {
+	uint8_t data[] = {0x57, 0x08, 0x40};
+	
+	deviceReset();
+	TEST_EQUAL(0, i2c_master_write(DEVICE_ADDR8, 0x20 | AUTO_INCREMENT, data, sizeof(data)));
+	TEST_EQUAL(0x57, deviceRegs[0x20]);
+	TEST_EQUAL(0x08, deviceRegs[0x21]);
+	TEST_EQUAL(0x40, deviceRegs[0x22]);
+	TEST_ASSERT(bit_is_set(TWCR, TWSTO));
+}
+
+static void test_read(void) {
+	uint8_t data[6];
+	
+	for (uint8_t i = 0; i < sizeof(data); i++) {
+		deviceRegs[0x28 + i] = 0xA0 + i;
+	}
+	deviceReset();
+	memset(data, 0, sizeof(data));
+	
+	// Register write then a repeated start for the read
+	TEST_EQUAL(0, i2c_master_read(DEVICE_ADDR8, 0x28 | AUTO_INCREMENT, data, sizeof(data)));
+	for (uint8_t i = 0; i < sizeof(data); i++) {
+		TEST_EQUAL(0xA0 + i, data[i]);
+	}
+	// The last byte is not acknowledged
+	TEST_EQUAL(TW_MR_DATA_NACK, TW_STATUS);
+}
+
+static void test_busError(void) {
+	uint8_t data = 0;
+	uint16_t errors = i2c_getErrors();
+	
+	deviceReset();
+	busError = true;
+	TEST_EQUAL(-1, i2c_master_read(DEVICE_ADDR8, 0x0F, &data, 1));
+	TEST_EQUAL(-1, i2c_master_write(DEVICE_ADDR8, 0x20, &data, 1));
+	TEST_EQUAL(errors + 2, i2c_getErrors());
+}
+
+static void test_addressNack(void) {
+	uint8_t data = 0;
+	uint16_t errors = i2c_getErrors();
+	
+	// No device answers the address
+	deviceReset();
+	TEST_EQUAL(-1, i2c_master_read(DEVICE_ADDR8 + 2, 0x0F, &data, 1));
+	TEST_EQUAL(TW_MT_SLA_NACK, TW_STATUS);
+	TEST_ASSERT(bit_is_set(TWCR, TWSTO));
+	
+	deviceReset();
+	TEST_EQUAL(-1, i2c_master_write(DEVICE_ADDR8 + 2, 0x20, &data, 1));
+	TEST_ASSERT(bit_is_set(TWCR, TWSTO));
+	TEST_EQUAL(errors + 2, i2c_getErrors());
+}
+
+static void test_slaveTransmit(void) {
+	uint8_t data[] = {0x11, 0x22};
+	
+	i2c_slave_init(0x40);
+	i2c_attachIrq_slave_read_recv(slaveRead);
+	TEST_EQUAL(sizeof(data), i2c_slave_transmit(data, sizeof(data)));
+	
+	TWSR = TW_ST_SLA_ACK;
+	hal_interrupt(TWI_vect);
+	TEST_EQUAL(1, slaveReads);
+	TEST_EQUAL(0x11, TWDR);
+	TEST_ASSERT(bit_is_set(TWCR, TWEA));
+	
+	// No acknowledge is expected after the last byte
+	TWSR = TW_ST_DATA_ACK;
+	hal_interrupt(TWI_vect);
+	TEST_EQUAL(0x22, TWDR);
+	TEST_ASSERT(bit_is_clear(TWCR, TWEA));
+	
+	TWSR = TW_ST_LAST_DATA;
+	hal_interrupt(TWI_vect);
+	TEST_ASSERT(bit_is_set(TWCR, TWEA));
+}
+
+int main() {
+	TEST_RUN(test_init);
+	TEST_RUN(test_write);
+	TEST_RUN(test_read);
+	TEST_RUN(test_busError);
+	TEST_RUN(test_addressNack);
+	TEST_RUN(test_slaveTransmit);
+	return test_report("i2c");
+}
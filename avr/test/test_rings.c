@@ -0,0 +1,121 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "test.h"
+#include "hal.h"
+#include "event.h"
+#include "workqueue.h"
+#include "trace.h"
+
+static uint8_t order[WORK_QUEUE_SIZE * 2];
+static uint8_t orderCount = 0;
+
+static void work(void * arg) {
+	order[orderCount++] = (uint8_t) (uintptr_t) arg;
+}
+
+static void test_workqueueOrder(void) {
+	hal_reset();
+	for (uintptr_t i = 0; i < 3; i++) {
+		TEST_ASSERT(workqueue_post(work, (void *) i));
+	}
+	TEST_ASSERT(event_wait() & EVENT_WORK);
+	
+	workqueue_run();
+	TEST_EQUAL(3, orderCount);
+	for (uint8_t i = 0; i < 3; i++) {
+		TEST_EQUAL(i, order[i]);
+	}
+}
+
+static void test_workqueueFull(void) {
+	uint16_t dropped = workqueue_getDropped();
+	
+	orderCount = 0;
+	// One slot is kept free to tell full from empty
+	for (uintptr_t i = 0; i < WORK_QUEUE_SIZE - 1; i++) {
+		TEST_ASSERT(workqueue_post(work, (void *) i));
+	}
+	TEST_ASSERT(!workqueue_post(work, NULL));
+	TEST_EQUAL(dropped + 1, workqueue_getDropped());
+	
+	workqueue_run();
+	TEST_EQUAL(WORK_QUEUE_SIZE - 1, orderCount);
+	TEST_EQUAL(WORK_QUEUE_SIZE - 2, order[WORK_QUEUE_SIZE - 2]);
+	event_wait();
+}
+
+static void test_traceRecords(void) {
+	const struct trace_dump * dump;
+	
+	trace_resume();
+	trace(TRACE_MARK, 1);
+	trace(TRACE_MARK, 2);
+	dump = trace_get();
+	
+	TEST_EQUAL(TRACE_FLAG_FROZEN, dump->flags);
+	TEST_EQUAL(2, dump->head);
+	TEST_EQUAL(TRACE_MARK, dump->records[1].id);
+	TEST_EQUAL(2, dump->records[1].arg);
+	
+	// Nothing is recorded while frozen
+	trace(TRACE_MARK, 3);
+	TEST_EQUAL(2, dump->head);
+}
+
+static void test_traceWraps(void) {
+	const struct trace_dump * dump;
+	
+	trace_resume();
+	for (uint16_t i = 0; i < TRACE_SIZE + 5; i++) {
+		trace(TRACE_MARK, i);
+	}
+	dump = trace_get();
+	
+	TEST_EQUAL(TRACE_FLAG_FROZEN | TRACE_FLAG_WRAPPED, dump->flags);
+	TEST_EQUAL(5, dump->head);
+	// The head is the oldest record
+	TEST_EQUAL(5, dump->records[dump->head].arg);
+	TEST_EQUAL(TRACE_SIZE + 4, dump->records[dump->head - 1].arg);
+}
+
+static void test_traceMask(void) {
+	const struct trace_dump * dump;
+	
+	trace_resume();
+	trace(TRACE_I2C_READ, 0x28);
+	trace_setMask(0xFF);
+	trace(TRACE_I2C_READ, 0x29);
+	trace_setMask(TRACE_MASK_DEFAULT);
+	dump = trace_get();
+	
+	TEST_EQUAL(1, dump->head);
+	TEST_EQUAL(0x29, dump->records[0].arg);
+}
+
+static void test_traceTrigger(void) {
+	const struct trace_dump * dump;
+	
+	trace_resume();
+	trace_setTrigger(TRACE_USER(1), 2);
+	trace(TRACE_MARK, 0);
+	trace(TRACE_USER(1), 0);
+	trace(TRACE_MARK, 1);
+	trace(TRACE_MARK, 2);
+	trace(TRACE_MARK, 3);
+	trace_setTrigger(0, 0);
+	dump = trace_get();
+	
+	// Frozen with the 2 records after the trigger
+	TEST_EQUAL(4, dump->head);
+	TEST_EQUAL(2, dump->records[3].arg);
+}
+
+int main() {
+	TEST_RUN(test_workqueueOrder);
+	TEST_RUN(test_workqueueFull);
+	TEST_RUN(test_traceRecords);
+	TEST_RUN(test_traceWraps);
+	TEST_RUN(test_traceMask);
+	TEST_RUN(test_traceTrigger);
+	return test_report("rings");
+}
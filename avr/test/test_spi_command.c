@@ -0,0 +1,142 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "test.h"
+#include "hal.h"
+#include "spi.h"
+#include "spi_command.h"
+#include "pin_config.h"
+
+#define CMD_UNLOCK_OPEN		(0xA1)
+#define CMD_GET_STATUS		(0xC1)
+#define CMD_TEST_BLOCK		(0xC9)
+
+static int unlockCount = 0;
+static const uint8_t blockData[] = {7, 8, 9};
+
+/**
+ * Replaces the weak callback of spi_command.c.
+ */
+int spicmd_callback_unlockopen(void) {
+	unlockCount++;
+	return 0;
+}
+
+static uint8_t openTestBlock(const uint8_t ** data) {
+	*data = blockData;
+	return sizeof(blockData);
+}
+
+/**
+ * One byte shifted by the BBB: the AVR answers what its last interrupt
+ * loaded in SPDR, then the interrupt reads the byte of the master.
+ * 
+ * @param mosi Byte sent by the master
+ * @return Byte received by the master
+ */
+static uint8_t transfer(uint8_t mosi) {
+	uint8_t miso = SPDR;
+	
+	SPDR = mosi;
+	hal_interrupt(SPI_STC_vect);
+	return miso;
+}
+
+static bool statusIsLow(void) {
+	return bit_is_set(BBB_STATUS_DDR, BBB_STATUS_IO) && bit_is_clear(BBB_STATUS_PORT, BBB_STATUS_IO);
+}
+
+static void test_init(void) {
+	hal_reset();
+	TEST_EQUAL(SPICMD_OK, spicmd_init());
+	TEST_EQUAL(SPI_CONTROL_SLAVE_IT | SPI_MODE_0 | SPI_ORDER_MSB_FIRST, SPCR);
+	TEST_ASSERT(!statusIsLow());
+	TEST_EQUAL(SPICMD_OK, spicmd_setBlock(CMD_TEST_BLOCK, openTestBlock));
+}
+
+static void test_statusEmpty(void) {
+	transfer(CMD_GET_STATUS);
+	TEST_EQUAL(SPICMD_NACK, transfer(0));
+}
+
+static void test_sendCommand(void) {
+	TEST_EQUAL(SPICMD_OK, spicmd_send(SPICMD_BBB_ALERT));
+	TEST_ASSERT(statusIsLow());
+	
+	transfer(CMD_GET_STATUS);
+	TEST_EQUAL(SPICMD_BBB_ALERT, transfer(0));
+	// Released once the queue is empty
+	TEST_ASSERT(!statusIsLow());
+}
+
+static void test_commandAcked(void) {
+	transfer(CMD_UNLOCK_OPEN);
+	TEST_EQUAL(1, unlockCount);
+	TEST_EQUAL(SPICMD_ACK, transfer(0));
+}
+
+static void test_desync(void) {
+	struct spicmd_stats before, after;
+	
+	spicmd_getStats(&before);
+	transfer(0x55);
+	TEST_EQUAL(SPICMD_NACK, transfer(0));
+	spicmd_getStats(&after);
+	
+	// The dummy 0x00 is not a desync
+	TEST_EQUAL(before.desyncs + 1, after.desyncs);
+	TEST_EQUAL(before.bytes + 2, after.bytes);
+}
+
+static void test_block(void) {
+	transfer(CMD_TEST_BLOCK);
+	TEST_EQUAL(sizeof(blockData), transfer(0));
+	for (uint8_t i = 0; i < sizeof(blockData); i++) {
+		TEST_EQUAL(blockData[i], transfer(0));
+	}
+	// Back to the commands after the dummy
+	transfer(0);
+	transfer(CMD_GET_STATUS);
+	TEST_EQUAL(SPICMD_NACK, transfer(0));
+}
+
+static void test_queueFull(void) {
+	struct spicmd_stats stats;
+	
+	// One slot is kept free to tell full from empty
+	for (uint8_t i = 0; i < OUTPUT_BUFFER_SIZE - 1; i++) {
+		TEST_EQUAL(SPICMD_OK, spicmd_send(i));
+	}
+	TEST_EQUAL(SPICMD_ERR_BUSY, spicmd_send(0xFF));
+	spicmd_getStats(&stats);
+	TEST_EQUAL(1, stats.queueFull);
+	
+	for (uint8_t i = 0; i < OUTPUT_BUFFER_SIZE - 1; i++) {
+		TEST_ASSERT(statusIsLow());
+		transfer(CMD_GET_STATUS);
+		TEST_EQUAL(i, transfer(0));
+	}
+	TEST_ASSERT(!statusIsLow());
+}
+
+static void test_blockTableFull(void) {
+	int status = SPICMD_OK;
+	
+	for (uint8_t i = 0; i < SPICMD_BLOCK_MAX && status == SPICMD_OK; i++) {
+		status = spicmd_setBlock(0xD0 + i, openTestBlock);
+	}
+	TEST_EQUAL(SPICMD_ERR_BUSY, status);
+}
+
+int main() {
+	TEST_RUN(test_init);
+	TEST_RUN(test_statusEmpty);
+	TEST_RUN(test_sendCommand);
+	TEST_RUN(test_commandAcked);
+	TEST_RUN(test_desync);
+	TEST_RUN(test_block);
+	TEST_RUN(test_queueFull);
+	TEST_RUN(test_blockTableFull);
+	return test_report("spi_command");
+}
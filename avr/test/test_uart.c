@@ -0,0 +1,126 @@
+#include <stdint.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "test.h"
+#include "hal.h"
+#include "uart.h"
+#include "defineConfig.h"
+#include "event.h"
+
+/**
+ * Receives a byte like the hardware: UDR0 then the Rx interrupt.
+ */
+static void receive(char c) {
+	UDR0 = c;
+	hal_interrupt(USART_RX_vect);
+}
+
+/**
+ * Runs the data register empty interrupt while it is enabled and keeps
+ * what was shifted out.
+ * 
+ * @return Number of bytes sent
+ */
+static int drain(char * out, int size) {
+	int count = 0;
+	
+	while (bit_is_set(UCSR0B, UDRIE0) && count < size) {
+		hal_interrupt(USART_UDRE_vect);
+		out[count++] = UDR0;
+	}
+	return count;
+}
+
+/**
+ * Empties the Rx buffer between tests.
+ */
+static void flush(void) {
+	while (uart_read() >= 0) {
+	}
+}
+
+static void test_open(void) {
+	hal_reset();
+	uart_open(9600, UART_DIRECTION_RXTX, UART_PARITY_NONE, UART_FRAME_SIZE_8BIT, UART_STOP_1BIT);
+	
+	// 16 MHz / (16 * 9600) - 1
+	TEST_EQUAL(103, UBRR0L);
+	TEST_EQUAL(0, UBRR0H);
+	TEST_ASSERT(bit_is_set(UCSR0B, RXEN0));
+	TEST_ASSERT(bit_is_set(UCSR0B, TXEN0));
+	TEST_ASSERT(bit_is_set(UCSR0B, RXCIE0));
+}
+
+static void test_receive(void) {
+	flush();
+	TEST_EQUAL(-1, uart_read());
+	
+	receive('o');
+	receive('k');
+	TEST_EQUAL(2, uart_available());
+	TEST_EQUAL('o', uart_read());
+	TEST_EQUAL('k', uart_read());
+	TEST_EQUAL(0, uart_available());
+}
+
+static void test_newlinePostsEvent(void) {
+	flush();
+	receive('a');
+	receive('\n');
+	
+	// Returns at once, an event is pending
+	TEST_ASSERT(event_wait() & EVENT_UART);
+}
+
+static void test_overrun(void) {
+	uint16_t overruns = uart_getOverruns();
+	
+	flush();
+	// One slot is kept free to tell full from empty
+	for (int i = 0; i < UART_RX_BUFFER_SIZE + 3; i++) {
+		receive('x');
+	}
+	TEST_EQUAL(UART_RX_BUFFER_SIZE - 1, uart_available());
+	TEST_EQUAL(overruns + 4, uart_getOverruns());
+	flush();
+}
+
+static void test_transmit(void) {
+	char out[16];
+	
+	uart_write('h', NULL);
+	uart_write('i', NULL);
+	uart_write('\n', NULL);
+	TEST_ASSERT(bit_is_set(UCSR0B, UDRIE0));
+	
+	// The newline is sent as \r\n and the interrupt stops when empty
+	TEST_EQUAL(4, drain(out, sizeof(out)));
+	TEST_ASSERT(memcmp(out, "hi\r\n", 4) == 0);
+	TEST_ASSERT(bit_is_clear(UCSR0B, UDRIE0));
+}
+
+static void test_transmitWraps(void) {
+	char out[UART_TX_BUFFER_SIZE];
+	
+	// Several times around the ring
+	for (int round = 0; round < 5; round++) {
+		for (int i = 0; i < UART_TX_BUFFER_SIZE / 2; i++) {
+			uart_write('a' + i % 26, NULL);
+		}
+		TEST_EQUAL(UART_TX_BUFFER_SIZE / 2, drain(out, sizeof(out)));
+		for (int i = 0; i < UART_TX_BUFFER_SIZE / 2; i++) {
+			TEST_EQUAL('a' + i % 26, out[i]);
+		}
+	}
+}
+
+int main() {
+	TEST_RUN(test_open);
+	TEST_RUN(test_receive);
+	TEST_RUN(test_newlinePostsEvent);
+	TEST_RUN(test_overrun);
+	TEST_RUN(test_transmit);
+	TEST_RUN(test_transmitWraps);
+	return test_report("uart");
+}
@@ -0,0 +1,208 @@
+#!/usr/bin/python
+
+# Reads the diagnostic blocks of the AVR over SPI
+#   python avr_diag.py health           health counters of the firmware
+#   python avr_diag.py isr              interrupt handler cycles (ISR_PROFILE build)
+#   python avr_diag.py trace            timeline of the trace, then resumes it
+#   python avr_diag.py trace-log FILE   timeline of a "-trace" dump captured on the UART
+# trace-log only decodes, it can run on any Linux machine
+
+import struct
+import sys
+import time
+
+# block commands, see spi_command.h
+isrProfile = 0xC2
+traceBlock = 0xC3
+traceResume = 0xC4
+healthBlock = 0xC5
+
+isrVectors = ["TIMER0_COMPA", "TIMER1_CAPT", "TIMER1_COMPA", "SPI_STC", "USART_RX",
+              "USART_UDRE", "TWI", "INT0", "ACCEL_INT2", "BOX_SWITCH"]
+
+# struct health_block of health.h, isrHits are the hits per second of each vector
+healthFormat = "<IHHIIHHHHHHHH%dHBBB" % len(isrVectors)
+healthFields = (["uptime", "heartbeat", "loopsPerSecond", "wakeups", "spiBytes", "spiDesyncs",
+                 "spiQueueFull", "workDropped", "uartOverruns", "i2cErrors", "stackUnused",
+                 "linkUpMs", "firstSpiMs"]
+                + ["isr " + vector for vector in isrVectors]
+                + ["resetCause", "ready", "version"])
+healthReadyBox = 0x01
+healthReadyAlert = 0x02
+# MCUSR bits
+resetCauses = [(0x08, "watchdog"), (0x04, "brown-out"), (0x02, "external"), (0x01, "power-on")]
+# cycles of the vector call, jump and reti not seen by the profiler
+isrOverhead = 11
+
+# trace ids and argument names, see trace.h and the TRACE_* of the modules
+boxStates = {1: "IDLE_OPEN", 2: "OPENING", 3: "IDLE_CLOSED", 4: "LOCKING", 6: "UNLOCKING",
+             7: "CLOSING", 8: "FAULT"}
+boxEvents = ["CMD_OPEN", "CMD_CLOSE", "CMD_QUERY", "LID_OPENED", "LID_CLOSED", "LOCK_CLEAR",
+             "LOCK_DONE", "LID_DONE", "TIMEOUT"]
+alertStates = {0: "OFF", 1: "OK", 3: "INTRUDER", 4: "CLASSIFYING", 10: "ARMED", 11: "DISARMED"}
+vibrationClasses = ["NONE", "BUMP", "LIFT", "PRY", "DROP"]
+traceIds = {
+    0x01: ("MARK", None),
+    0x02: ("TICK", None),
+    0x20: ("SPI_BYTE", None),
+    0x40: ("I2C_READ", None),
+    0x41: ("I2C_WRITE", None),
+    0x42: ("I2C_ERROR", None),
+    0x80: ("BOX_EVENT", boxEvents),
+    0x81: ("BOX_STATE", boxStates),
+    0x82: ("BOX_FAULT", boxStates),
+    0xA0: ("ALERT_INT", None),
+    0xA1: ("ALERT_STATE", alertStates),
+    0xA2: ("ALERT_CLASS", vibrationClasses),
+    0xC0: ("SPICMD_SEND", None),
+}
+traceFrozen = 0x01
+traceWrapped = 0x02
+
+# delay between bytes so the AVR interrupt can load the next one
+byteDelay = 0.0005
+
+
+# reads a block: the command, the size, then one byte per transfer
+def read_block(spi, cmd):
+    spi.xfer2([cmd])
+    time.sleep(byteDelay)
+    size = spi.xfer2([0])[0]
+    data = bytearray()
+    for i in range(size):
+        time.sleep(byteDelay)
+        data.append(spi.xfer2([0])[0])
+    # the dummy that brings the AVR back to wait for a command
+    time.sleep(byteDelay)
+    spi.xfer2([0])
+    return bytes(data)
+
+
+# struct isrprof_stats: count, total, min, max, little endian
+def decode_isr_profile(data):
+    stats = []
+    for offset in range(0, len(data) - 11, 12):
+        count, total, low, high = struct.unpack_from("<IIHH", data, offset)
+        stats.append((count, total, low, high))
+    return stats
+
+
+def print_isr_profile(spi):
+    data = read_block(spi, isrProfile)
+    if len(data) == 0:
+        sys.exit("No ISR profile, build the AVR with DEFS=-DISR_PROFILE")
+    print("%-12s %10s %5s %5s %5s cycles (+%d)" % ("Vector", "hits", "min", "avg", "max", isrOverhead))
+    for i, (count, total, low, high) in enumerate(decode_isr_profile(data)):
+        name = isrVectors[i] if i < len(isrVectors) else str(i)
+        average = total // count if count else 0
+        print("%-12s %10d %5d %5d %5d" % (name, count, low, average, high))
+
+
+# returns the health block as a dict, None if the AVR did not answer a block
+def decode_health(data):
+    if len(data) != struct.calcsize(healthFormat):
+        return None
+    return dict(zip(healthFields, struct.unpack(healthFormat, data)))
+
+
+def reset_cause_name(cause):
+    names = [name for bit, name in resetCauses if cause & bit]
+    return ", ".join(names) if names else "unknown (0x%02X)" % cause
+
+
+def read_health(spi):
+    return decode_health(read_block(spi, healthBlock))
+
+
+def print_health(spi):
+    health = read_health(spi)
+    if health is None:
+        sys.exit("The AVR did not answer the health block")
+    for field in healthFields:
+        print("%-16s %d" % (field, health[field]))
+    print("%-16s %s" % ("reset", reset_cause_name(health["resetCause"])))
+    print("%-16s box: %s, alert: %s" % ("ready", bool(health["ready"] & healthReadyBox),
+                                       bool(health["ready"] & healthReadyAlert)))
+
+
+# struct trace_dump: anchor millis and stamp, head, flags, then the ring
+# returns (milliseconds since boot, id, arg) from the oldest record
+def decode_trace(data):
+    anchor_millis, anchor_time, head, flags = struct.unpack_from("<IHBB", data, 0)
+    size = (len(data) - 8) // 4
+    ring = [struct.unpack_from("<HBB", data, 8 + 4 * i) for i in range(size)]
+    records = ring[head:] + ring[:head] if flags & traceWrapped else ring[:head]
+    if not flags & traceFrozen or not records:
+        return []
+
+    # the stamps are in 1/16 ms and wrap every 4.096 s, they are unwrapped
+    # backward from the anchor taken when the trace was frozen
+    timeline = []
+    now = anchor_millis * 16 + (anchor_time & 0xF)
+    last = anchor_time
+    for stamp, event, arg in reversed(records):
+        now -= (last - stamp) & 0xFFFF
+        last = stamp
+        timeline.append((now / 16.0, event, arg))
+    timeline.reverse()
+    return timeline
+
+
+def format_arg(event, arg):
+    names = traceIds.get(event, (None, None))[1]
+    if isinstance(names, dict) and arg in names:
+        return names[arg]
+    if isinstance(names, list) and arg < len(names):
+        return names[arg]
+    return "0x%02X" % arg
+
+
+def print_timeline(timeline):
+    previous = None
+    for ms, event, arg in timeline:
+        name = traceIds.get(event, ("0x%02X" % event, None))[0]
+        delta = "" if previous is None else "+%.2f" % (ms - previous)
+        print("%12.2f %10s  %-12s %s" % (ms, delta, name, format_arg(event, arg)))
+        previous = ms
+
+
+def print_trace(spi):
+    data = read_block(spi, traceBlock)
+    read_block(spi, traceResume)
+    print_timeline(decode_trace(data))
+
+
+# the hex lines between "TRACE <size>" and "TRACE END" of the console
+def read_trace_log(path):
+    data = bytearray()
+    inside = False
+    with open(path) as log:
+        for line in log:
+            line = line.strip()
+            if line.startswith("TRACE END"):
+                break
+            if inside:
+                data.extend(int(byte, 16) for byte in line.split())
+            elif line.startswith("TRACE"):
+                inside = True
+    return bytes(data)
+
+
+def main():
+    if len(sys.argv) == 3 and sys.argv[1] == "trace-log":
+        print_timeline(decode_trace(read_trace_log(sys.argv[2])))
+        return
+
+    commands = {"health": print_health, "isr": print_isr_profile, "trace": print_trace}
+    if len(sys.argv) != 2 or sys.argv[1] not in commands:
+        sys.exit("usage: avr_diag.py " + "|".join(sorted(commands)) + "|trace-log FILE")
+
+    from Adafruit_BBIO.SPI import SPI
+    spi = SPI(1, 0)
+    spi.mode = 0
+    spi.msh = 1000000
+    commands[sys.argv[1]](spi)
+
+
+if __name__ == "__main__":
+    main()
@@ -8,6 +8,7 @@ import subprocess
 from usb_cam import take_picture_and_recognize
 from usb_cam import take_picture
 from send_email import send_alert
+from avr_diag import read_health, reset_cause_name, healthReadyAlert
 
 from Adafruit_BBIO.SPI import SPI
 
@@ -29,6 +30,7 @@ opened = 0xEA
 closed = 0xEB
 statusGPIO = 0xC1
 alertStatus = 0xB1
+boxFault = 0xB2
 openBox = 0xA1
 closeBox = 0xA2
 
@@ -37,6 +39,16 @@ spi = SPI(1, 0)
 spi.mode = 0
 spi.msh = 1000000
 
+# AVR health polling, a heartbeat that does not move for healthWedgedPolls
+# polls means the AVR main loop is wedged
+healthPeriod = 2
+healthWedgedPolls = 3
+# counters of the health block that should never increase
+healthErrorCounters = ["spiDesyncs", "spiQueueFull", "workDropped", "uartOverruns", "i2cErrors"]
+lastHealth = None
+lastHealthPoll = 0
+staleHeartbeats = 0
+
 
 # initialization
 def bbb_init():
@@ -171,6 +183,7 @@ def bbb_execute():
     bbb_init()
     red_led_on()
     while True:
+        check_avr_health()
         cmd_get_status()
         # if the button is pressed
         if GPIO.input("P8_12"):
@@ -188,11 +201,59 @@ def bbb_execute():
 def cmd_get_status():
     if not GPIO.input("P8_9"):
         spi.xfer2([statusGPIO])
-        if alertStatus == spi_response([0]):
+        status = spi_response([0])
+        if alertStatus == status:
             # we send an alert to user via email
             take_picture()
             send_alert("/var/lib/cloud9/theBox/unknown.jpg",1)
             print("Sending email alert...")
+        elif boxFault == status:
+            # the lid or the lock did not reach its position
+            print("Error. Box is jammed")
+            yellow_led_off()
+            green_led_off()
+            red_led_on()
+
+
+# the AVR does not answer or its main loop is stuck
+def avr_health_alert(message):
+    print("Error. AVR " + message)
+    yellow_led_on()
+    red_led_on()
+
+
+# polls the health block of the AVR every healthPeriod seconds
+def check_avr_health():
+    global lastHealth, lastHealthPoll, staleHeartbeats
+    if time.time() - lastHealthPoll < healthPeriod:
+        return
+    lastHealthPoll = time.time()
+
+    health = read_health(spi)
+    if health is None:
+        avr_health_alert("is not responding")
+        return
+
+    if lastHealth is not None:
+        if health["uptime"] < lastHealth["uptime"]:
+            print("AVR was reset: " + reset_cause_name(health["resetCause"]))
+            print("AVR link up in %d ms" % health["linkUpMs"])
+            staleHeartbeats = 0
+        elif health["heartbeat"] == lastHealth["heartbeat"]:
+            staleHeartbeats += 1
+            if staleHeartbeats == healthWedgedPolls:
+                avr_health_alert("main loop is wedged")
+        else:
+            if staleHeartbeats >= healthWedgedPolls:
+                print("AVR main loop recovered")
+                yellow_led_off()
+            staleHeartbeats = 0
+            if health["ready"] & healthReadyAlert and not lastHealth["ready"] & healthReadyAlert:
+                print("AVR motion alert ready")
+            for counter in healthErrorCounters:
+                if health[counter] > lastHealth[counter]:
+                    print("AVR %s: %d" % (counter, health[counter]))
+    lastHealth = health
 
 
 def check_box_status():